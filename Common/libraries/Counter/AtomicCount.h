@@ -0,0 +1,122 @@
+#ifndef ATOMICCOUNT_H
+#define ATOMICCOUNT_H
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <utility>
+#ifdef ESP_PLATFORM
+#include "esp_cpu.h"
+#else
+#include <functional>
+#include <thread>
+#endif
+/*
+Lock-free counters that can be shared between ISRs and tasks.
+
+cCount mutates plain ints and flag pointers, so concurrent use races. These
+classes only use std::atomic read-modify-write operations (S32C1I on Xtensa,
+interrupt-masked emulation on single-core RISC-V targets), so count() may be
+called from a GPIO ISR while a task reads or resets the value. Everything is
+inline so ISR code does not call into another translation unit.
+*/
+class cAtomicCount{
+    private:
+        std::atomic<int32_t> _cnt{0};
+        std::atomic<int32_t> _goal{0};// 0 = no goal, counter never wraps
+        std::atomic<uint32_t> _laps{0};// Goal crossings not yet consumed by finish()
+    public:
+        cAtomicCount(int32_t goal=0){_goal.store(goal, std::memory_order_relaxed);}
+        void setGoal(int32_t goal){
+            _goal.store(goal, std::memory_order_relaxed);
+            _cnt.store(0, std::memory_order_relaxed);
+        }
+        // Plain fetch-add, returns the previous value (ignores the goal)
+        int32_t fetchAdd(int32_t n=1){return _cnt.fetch_add(n, std::memory_order_relaxed);}
+        // Add n and wrap at the goal. Returns true if this call crossed the goal (ISR safe)
+        bool count(int32_t n=1){
+            int32_t goal=_goal.load(std::memory_order_relaxed);
+            if(goal<=0){
+                _cnt.fetch_add(n, std::memory_order_relaxed);
+                return false;
+            }
+            int32_t cur=_cnt.load(std::memory_order_relaxed);
+            int32_t next;
+            uint32_t crossed;
+            do{
+                next=cur+n;
+                crossed=0;
+                if(next>=goal){
+                    crossed=next/goal;
+                    next%=goal;
+                }
+            }while(!_cnt.compare_exchange_weak(cur, next, std::memory_order_acq_rel, std::memory_order_relaxed));
+            if(crossed){
+                _laps.fetch_add(crossed, std::memory_order_release);
+                return true;
+            }
+            return false;
+        }
+        int32_t get(){return _cnt.load(std::memory_order_relaxed);}
+        uint32_t laps(){return _laps.load(std::memory_order_acquire);}
+        // Consume one goal crossing - true once per crossing, even if several happened between polls
+        bool finish(){
+            uint32_t pending=_laps.load(std::memory_order_acquire);
+            while(pending>0){
+                if(_laps.compare_exchange_weak(pending, pending-1, std::memory_order_acq_rel, std::memory_order_acquire)){return true;}
+            }
+            return false;
+        }
+        template<typename Func, typename... Args>
+        void after(Func callback, Args&&... args){
+            if(finish()){
+                callback(std::forward<Args>(args)...);
+            }
+        }
+        // Read and zero atomically - useful for per-period rates
+        int32_t take(){return _cnt.exchange(0, std::memory_order_acq_rel);}
+        void reset(){
+            _cnt.store(0, std::memory_order_relaxed);
+            _laps.store(0, std::memory_order_relaxed);
+        }
+};
+/*
+Per-core sharded counter for very high event rates.
+
+Each core increments its own cache-line aligned slot, so ISRs on different
+cores never contend on the same word. get() sums the shards and is meant for
+the slower reader side.
+*/
+template<size_t SHARDS=2>
+class cShardedCount{
+    private:
+        struct alignas(32) shard{
+            std::atomic<uint32_t> value{0};
+        };
+        shard _shards[SHARDS];
+        static size_t shardIndex(){
+#ifdef ESP_PLATFORM
+            return (size_t)esp_cpu_get_core_id()%SHARDS;
+#else
+            return std::hash<std::thread::id>()(std::this_thread::get_id())%SHARDS;
+#endif
+        }
+    public:
+        cShardedCount(){};
+        void count(uint32_t n=1){_shards[shardIndex()].value.fetch_add(n, std::memory_order_relaxed);}
+        uint32_t get(){
+            uint32_t sum=0;
+            for(size_t i=0;i<SHARDS;i++){sum+=_shards[i].value.load(std::memory_order_relaxed);}
+            return sum;
+        }
+        // Read and zero every shard; events counted concurrently land in the next take()
+        uint32_t take(){
+            uint32_t sum=0;
+            for(size_t i=0;i<SHARDS;i++){sum+=_shards[i].value.exchange(0, std::memory_order_acq_rel);}
+            return sum;
+        }
+        void reset(){
+            for(size_t i=0;i<SHARDS;i++){_shards[i].value.store(0, std::memory_order_relaxed);}
+        }
+};
+
+#endif // ATOMICCOUNT_H
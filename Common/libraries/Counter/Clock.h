@@ -0,0 +1,43 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+#include <stdint.h>
+/*
+Time source for cTime and cScheduler, selected at compile time.
+
+- espClock:    esp_timer_get_time(), default on ESP-IDF (inline, no overhead)
+- hostClock:   std::chrono::steady_clock, default on host builds
+- manualClock: virtual time moved by set()/advance(), for deterministic
+               simulation; enable with -DCOUNTER_CLOCK_MANUAL
+
+All clocks return microseconds from an arbitrary monotonic origin.
+*/
+#ifdef ESP_PLATFORM
+#include "esp_timer.h"
+struct espClock{
+    static inline int64_t now(){return esp_timer_get_time();}
+};
+#else
+#include <chrono>
+struct hostClock{
+    static inline int64_t now(){
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+};
+#endif
+#include <atomic>
+struct manualClock{
+    static inline std::atomic<int64_t> _now{0};
+    static inline int64_t now(){return _now.load(std::memory_order_relaxed);}
+    static inline void set(int64_t microsec){_now.store(microsec, std::memory_order_relaxed);}
+    static inline void advance(int64_t microsec){_now.fetch_add(microsec, std::memory_order_relaxed);}
+};
+
+#if defined(COUNTER_CLOCK_MANUAL)
+typedef manualClock counterClock;
+#elif defined(ESP_PLATFORM)
+typedef espClock counterClock;
+#else
+typedef hostClock counterClock;
+#endif
+
+#endif // CLOCK_H
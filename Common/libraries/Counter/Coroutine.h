@@ -0,0 +1,112 @@
+#ifndef COROUTINE_H
+#define COROUTINE_H
+/*
+Cooperative C++20 coroutine runtime on top of cScheduler.
+
+A cCo is a coroutine that suspends with `co_await sleepFor(ms)`. Its frame
+(typically a few hundred bytes) lives on the heap, so dozens of sequences can
+share one FreeRTOS task instead of each needing its own stack:
+
+    cCo blink(pinManager& pins, const char* led, int periodMs);
+    cCoLoop loop;
+    loop.spawn(blink(pins, "led1", 250));
+    loop.spawn(blink(pins, "led2", 400));
+    while (1) { loop.run(); vTaskDelay(pdMS_TO_TICKS(loop.next() / 1000)); }
+
+Requires C++20 (ESP-IDF 5.x builds with gnu++2x or newer by default).
+*/
+#if !defined(__cpp_impl_coroutine)
+#error "Coroutine.h requires C++20 coroutine support (-std=gnu++20)"
+#endif
+#include <coroutine>
+#include <exception>
+#include <vector>
+#include "Scheduler.h"
+
+class cCoLoop;
+
+class cCo{
+    public:
+        struct promise_type{
+            cCoLoop* loop=nullptr;
+            cCo get_return_object(){return cCo(std::coroutine_handle<promise_type>::from_promise(*this));}
+            std::suspend_always initial_suspend() noexcept {return {};}// Started by cCoLoop::spawn()
+            std::suspend_always final_suspend() noexcept {return {};}// Frame reclaimed by cCoLoop::run()
+            void return_void(){}
+            void unhandled_exception(){std::terminate();}
+        };
+        typedef std::coroutine_handle<promise_type> handle_t;
+    private:
+        handle_t _handle;
+    public:
+        explicit cCo(handle_t handle): _handle(handle) {};
+        cCo(cCo&& other) noexcept : _handle(other._handle) {other._handle=nullptr;}
+        cCo(const cCo&)=delete;
+        cCo& operator=(const cCo&)=delete;
+        handle_t release(){
+            handle_t handle=_handle;
+            _handle=nullptr;
+            return handle;
+        }
+        ~cCo(){
+            if(_handle){_handle.destroy();}// Never spawned
+        }
+};
+
+class cCoLoop{
+    private:
+        cScheduler _sched;
+        std::vector<cCo::handle_t> _tasks;
+        static void resume(void* address){
+            std::coroutine_handle<>::from_address(address).resume();
+        }
+    public:
+        cCoLoop(){};
+        // Take ownership of a coroutine; it starts on the next run()
+        void spawn(cCo&& co){
+            cCo::handle_t handle=co.release();
+            if(!handle){return;}
+            handle.promise().loop=this;
+            _tasks.push_back(handle);
+            _sched.add(0, resume, handle.address(), false);
+        }
+        // Resume after delayMicrosec - called by the sleep awaitable
+        void wake(std::coroutine_handle<> handle, int64_t delayMicrosec){
+            _sched.add(delayMicrosec, resume, handle.address(), false);
+        }
+        // Resume every coroutine whose sleep expired, then free finished ones. Returns resumes done
+        size_t run(){
+            size_t resumed=_sched.run();
+            for(size_t i=0;i<_tasks.size();){
+                if(_tasks[i].done()){
+                    _tasks[i].destroy();
+                    _tasks[i]=_tasks.back();
+                    _tasks.pop_back();
+                }else{
+                    i++;
+                }
+            }
+            return resumed;
+        }
+        // Microseconds until a coroutine needs to run (-1 when none are sleeping)
+        int64_t next(){return _sched.next();}
+        size_t size(){return _tasks.size();}
+        ~cCoLoop(){
+            _sched.clear();
+            for(auto& handle : _tasks){handle.destroy();}
+            _tasks.clear();
+        }
+};
+
+struct cSleep{
+    int64_t micros;
+    bool await_ready() const noexcept {return false;}
+    void await_suspend(cCo::handle_t handle){handle.promise().loop->wake(handle, micros);}
+    void await_resume() const noexcept {}
+};
+// co_await sleepFor(ms) / sleepMicros(us) suspend on the loop's scheduler; yieldNow() lets others run
+inline cSleep sleepFor(int64_t millisec){return cSleep{millisec*1000};}
+inline cSleep sleepMicros(int64_t microsec){return cSleep{microsec};}
+inline cSleep yieldNow(){return cSleep{0};}
+
+#endif // COROUTINE_H
@@ -7,7 +7,7 @@
  * @date 2025-10-02
  * @author Eubry Gomez Ramirez
  */
-#include "counter.h"
+#include "Counter.h"
 
 void cCount::checkGoalChange(int goal){
     if(_pvGoal!=goal){
@@ -54,6 +54,43 @@ cCount::~cCount(){
     _cnt=0;
     _rdy=false;
 }
+//--------------Jitter Statistics Implementation----------------
+void cJitter::record(int64_t latenessMicrosec){
+    if(latenessMicrosec<0){latenessMicrosec=0;}
+    if(_count==0 || latenessMicrosec<_min){_min=latenessMicrosec;}
+    if(_count==0 || latenessMicrosec>_max){_max=latenessMicrosec;}
+    _sum+=latenessMicrosec;
+    _count++;
+    uint8_t index=0;
+    while(index<BUCKETS-1 && latenessMicrosec>=((int64_t)1<<index)){index++;}
+    _hist[index]++;
+}
+uint32_t cJitter::count(){return _count;}
+int64_t cJitter::min(){return _min;}
+int64_t cJitter::max(){return _max;}
+int64_t cJitter::mean(){return _count ? _sum/_count : 0;}
+int64_t cJitter::percentile(float p){
+    if(_count==0){return 0;}
+    uint32_t target=(uint32_t)((p/100.0f)*_count);
+    if(target<1){target=1;}
+    uint32_t seen=0;
+    for(uint8_t i=0;i<BUCKETS;i++){
+        seen+=_hist[i];
+        if(seen>=target){
+            int64_t upper=((int64_t)1<<i)-1;// Largest value that lands in bucket i
+            return (upper<_max)?upper:_max;
+        }
+    }
+    return _max;
+}
+uint32_t cJitter::bucket(uint8_t index){return (index<BUCKETS)?_hist[index]:0;}
+void cJitter::reset(){
+    for(uint8_t i=0;i<BUCKETS;i++){_hist[i]=0;}
+    _count=0;
+    _min=0;
+    _max=0;
+    _sum=0;
+}
 //--------------Time Counter Implementation----------------
 void cTime::checkGoalChange(int64_t goalMicrosec){{
     if(_goalTime!=goalMicrosec){
@@ -63,18 +100,35 @@ void cTime::checkGoalChange(int64_t goalMicrosec){{
 }}
 void cTime::wait(int64_t goalMicrosec){
     checkGoalChange(goalMicrosec);
-    int64_t currentTime=esp_timer_get_time();
+    int64_t currentTime=counterClock::now();
     _elapsedTime= (currentTime - _lastTime);//Calculate elapsed time in microseconds
     _rdy=false;
     if(cntFirst<2){
         cntFirst++;
     }
     if(_elapsedTime>=_goalTime){
+        int64_t lateness=_elapsedTime-_goalTime;
+        if(_stats){_stats->record(lateness);}
         _rdy=true;
         _elapsedTime=0;
-        _lastTime=currentTime;
+        if(_periodic && _goalTime>0){
+            _lastTime+=_goalTime;// Next deadline is exactly one period later - polling latency does not drift
+            if(lateness>=_goalTime && _policy==catchUp::SKIP){
+                int64_t skipped=lateness/_goalTime;
+                _lastTime+=skipped*_goalTime;
+                _missed+=skipped;
+            }
+        }else{
+            _lastTime=currentTime;
+        }
     }
 }
+void cTime::periodic(bool enable, catchUp policy){
+    _periodic=enable;
+    _policy=policy;
+}
+void cTime::stats(cJitter* jitter){_stats=jitter;}
+uint32_t cTime::missed(){return _missed;}
 bool cTime::start(){
     return (cntFirst==1)?true:((_elapsedTime==0)?true:false);//returns true when timer resets
 }
@@ -84,10 +138,12 @@ int64_t cTime::get(){
 }
 void cTime::reset(){
     _elapsedTime=0;
+    _missed=0;
     cntFirst=0;
-    _lastTime=esp_timer_get_time();
+    _lastTime=counterClock::now();
 }
 cTime::~cTime(){
+    _stats=nullptr;
     _goalTime=0;
     _lastTime=0;
     _elapsedTime=0;
@@ -1,7 +1,7 @@
 #ifndef COUNTER_H
 #define COUNTER_H
 #include <utility>
-#include "esp_timer.h"
+#include "Clock.h"
 class cCount{
     private:
         int _cnt=0;
@@ -30,17 +30,53 @@ class cCount{
     void reset();
     ~cCount();
 };
+/*
+Lateness statistics for cTime deadlines (how late each deadline was served).
+Samples go into log2 microsecond buckets, so percentiles are bucket upper bounds.
+*/
+class cJitter{
+    public:
+        static constexpr uint8_t BUCKETS=24;// Bucket i holds lateness < 2^i us (last bucket: everything above)
+    private:
+        uint32_t _hist[BUCKETS]={0};
+        uint32_t _count=0;
+        int64_t _min=0;
+        int64_t _max=0;
+        int64_t _sum=0;
+    public:
+        cJitter(){};
+        void record(int64_t latenessMicrosec);
+        uint32_t count();
+        int64_t min();
+        int64_t max();
+        int64_t mean();
+        int64_t percentile(float p);// p in 0-100, e.g. percentile(99)
+        uint32_t bucket(uint8_t index);
+        void reset();
+};
 class cTime{
+    public:
+        enum class catchUp : uint8_t {
+            SKIP = 0,// Drop missed periods and stay on the original grid
+            BURST = 1// Fire once per missed period on the following wait() calls
+        };
     private:
         int64_t _goalTime=0;
         int64_t _lastTime=0;
         int64_t _elapsedTime=0;
+        uint32_t _missed=0;
+        cJitter* _stats=nullptr;
         int8_t cntFirst=0;
         bool _rdy=false;
+        bool _periodic=false;
+        catchUp _policy=catchUp::SKIP;
         void checkGoalChange(int64_t goalMillisec);
     public:
         cTime(): _goalTime(0), _lastTime(0), _elapsedTime(0) {};
         void wait(int64_t goalMillisec);
+        void periodic(bool enable=true, catchUp policy=catchUp::SKIP);
+        void stats(cJitter* jitter);
+        uint32_t missed();
         bool start();
         bool finish();
         int64_t get();
@@ -0,0 +1,146 @@
+/**
+ * @file Scheduler.cpp
+ * @brief Implementation of the cScheduler class, a min-heap of software timers.
+ * @version 1.0.0
+ * @date 2026-10-18
+ * @author Eubry Gomez Ramirez
+ */
+#include "Scheduler.h"
+
+bool cScheduler::before(int32_t a, int32_t b){
+    return _slots[a].deadline < _slots[b].deadline;
+}
+void cScheduler::swapNodes(size_t a, size_t b){
+    int32_t tmp=_heap[a];
+    _heap[a]=_heap[b];
+    _heap[b]=tmp;
+    _slots[_heap[a]].heapPos=a;
+    _slots[_heap[b]].heapPos=b;
+}
+void cScheduler::siftUp(size_t pos){
+    while(pos>0){
+        size_t parent=(pos-1)/2;
+        if(!before(_heap[pos],_heap[parent])){break;}
+        swapNodes(pos,parent);
+        pos=parent;
+    }
+}
+void cScheduler::siftDown(size_t pos){
+    size_t count=_heap.size();
+    while(true){
+        size_t left=pos*2+1;
+        size_t right=left+1;
+        size_t smallest=pos;
+        if(left<count && before(_heap[left],_heap[smallest])){smallest=left;}
+        if(right<count && before(_heap[right],_heap[smallest])){smallest=right;}
+        if(smallest==pos){break;}
+        swapNodes(pos,smallest);
+        pos=smallest;
+    }
+}
+void cScheduler::removeAt(size_t pos){
+    int32_t slot=_heap[pos];
+    size_t last=_heap.size()-1;
+    if(pos!=last){
+        swapNodes(pos,last);
+    }
+    _heap.pop_back();
+    if(pos<_heap.size()){
+        siftDown(pos);
+        siftUp(pos);
+    }
+    _slots[slot].heapPos=-1;
+    _slots[slot].generation++;
+    _free.push_back(slot);
+}
+// Ids pack the slot index (low 16 bits) with its generation (high 15 bits)
+int32_t cScheduler::slotOf(int id){
+    if(id<0){return -1;}
+    int32_t slot=id & 0xFFFF;
+    if(slot>=(int32_t)_slots.size()){return -1;}
+    if(_slots[slot].heapPos<0 || (_slots[slot].generation & 0x7FFF)!=((id>>16) & 0x7FFF)){return -1;}
+    return slot;
+}
+void cScheduler::reserve(size_t timers){
+    _slots.reserve(timers);
+    _heap.reserve(timers);
+    _free.reserve(timers);
+}
+// Schedule callback(arg) after periodMicrosec, then every periodMicrosec if repeat. Returns a timer id
+int cScheduler::add(int64_t periodMicrosec, callback_t callback, void* arg, bool repeat){
+    if(callback==nullptr || (repeat && periodMicrosec<=0)){return INVALID;}
+    int32_t slot;
+    if(!_free.empty()){
+        slot=_free.back();
+        _free.pop_back();
+    }else{
+        if(_slots.size()>0xFFFF){return INVALID;}
+        slot=_slots.size();
+        _slots.push_back(timerSlot());
+    }
+    timerSlot& t=_slots[slot];
+    t.deadline=counterClock::now()+periodMicrosec;
+    if(_running && t.deadline<=_passTime){t.deadline=_passTime+1;}// Added during run(): due on the next pass
+    t.period=periodMicrosec;
+    t.callback=callback;
+    t.arg=arg;
+    t.repeat=repeat;
+    t.heapPos=_heap.size();
+    _heap.push_back(slot);
+    siftUp(t.heapPos);
+    return ((t.generation & 0x7FFF)<<16) | slot;
+}
+bool cScheduler::cancel(int id){
+    int32_t slot=slotOf(id);
+    if(slot<0){return false;}
+    removeAt(_slots[slot].heapPos);
+    return true;
+}
+bool cScheduler::active(int id){return slotOf(id)>=0;}
+// Fire every timer whose deadline has passed. Callbacks may add or cancel timers
+size_t cScheduler::run(){
+    int64_t currentTime=counterClock::now();
+    size_t fired=0;
+    bool nested=_running;// run() called from a callback
+    int64_t outerTime=_passTime;
+    _passTime=currentTime;
+    _running=true;
+    while(!_heap.empty()){
+        int32_t slot=_heap[0];
+        timerSlot& t=_slots[slot];
+        if(t.deadline>currentTime){break;}
+        callback_t callback=t.callback;
+        void* arg=t.arg;
+        if(t.repeat){
+            t.deadline+=t.period;
+            if(t.deadline<=currentTime){// Missed periods: skip ahead, stay on the original grid
+                t.deadline+=((currentTime-t.deadline)/t.period+1)*t.period;
+            }
+            siftDown(0);
+        }else{
+            removeAt(0);
+        }
+        callback(arg);// t may be invalid here if the callback added timers
+        fired++;
+    }
+    _running=nested;
+    _passTime=outerTime;
+    return fired;
+}
+// Microseconds until the next deadline (0 if one is due, -1 if no timers)
+int64_t cScheduler::next(){
+    if(_heap.empty()){return -1;}
+    int64_t remaining=_slots[_heap[0]].deadline-counterClock::now();
+    return (remaining>0)?remaining:0;
+}
+size_t cScheduler::size(){return _heap.size();}
+void cScheduler::clear(){
+    while(!_heap.empty()){
+        removeAt(_heap.size()-1);
+    }
+}
+cScheduler::~cScheduler(){
+    _heap.clear();
+    _slots.clear();
+    _free.clear();
+}
@@ -0,0 +1,57 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "Counter.h"
+/*
+Central timer scheduler - owns many software timers and fires their callbacks.
+
+Deadlines live in a binary min-heap, so add/cancel cost O(log n) and the next
+deadline is read in O(1). The loop calls run() once and then sleeps for next()
+microseconds instead of polling every cTime object.
+
+Periodic timers advance by exactly one period from their previous deadline,
+so polling latency never accumulates as drift; missed periods are skipped.
+Timers added from a callback wait for the next run(), even with a zero delay,
+so a callback that keeps re-adding itself cannot starve the others.
+*/
+class cScheduler{
+    public:
+        typedef void (*callback_t)(void* arg);
+        static constexpr int INVALID = -1;
+    private:
+        struct timerSlot{
+            int64_t deadline=0;
+            int64_t period=0;
+            callback_t callback=nullptr;
+            void* arg=nullptr;
+            int32_t heapPos=-1;// -1 when the slot is free
+            uint16_t generation=0;// Invalidates ids of cancelled timers
+            bool repeat=false;
+        };
+        std::vector<timerSlot> _slots;
+        std::vector<int32_t> _heap;// Slot indices ordered by deadline
+        std::vector<int32_t> _free;
+        int64_t _passTime=0;// currentTime of the run() in progress
+        bool _running=false;
+        bool before(int32_t a, int32_t b);
+        void swapNodes(size_t a, size_t b);
+        void siftUp(size_t pos);
+        void siftDown(size_t pos);
+        void removeAt(size_t pos);
+        int32_t slotOf(int id);
+    public:
+        cScheduler(){};
+        void reserve(size_t timers);
+        int add(int64_t periodMicrosec, callback_t callback, void* arg=nullptr, bool repeat=true);
+        bool cancel(int id);
+        bool active(int id);
+        size_t run();
+        int64_t next();
+        size_t size();
+        void clear();
+        ~cScheduler();
+};
+
+#endif // SCHEDULER_H
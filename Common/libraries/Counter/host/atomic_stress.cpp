@@ -0,0 +1,82 @@
+/**
+ * @file atomic_stress.cpp
+ * @brief Multi-threaded stress test for cAtomicCount and cShardedCount
+ *
+ * 8 writer threads count concurrently while a reader thread consumes goal
+ * crossings with finish(). Every crossing must be consumed exactly once, and
+ * the final count must be the remainder. Exits non-zero on any mismatch.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "AtomicCount.h"
+
+#define WRITERS 8
+#define COUNTS_PER_WRITER 1000000
+#define GOAL 997// Prime, so crossings land at every offset of each writer's run
+
+static int failures = 0;
+static void check(bool ok, const char* what, long long got, long long expected){
+    printf("%-40s %lld (expected %lld) %s\n", what, got, expected, ok ? "ok" : "FAIL");
+    if(!ok){failures++;}
+}
+
+static void stressAtomic(){
+    cAtomicCount counter(GOAL);
+    std::atomic<bool> writing{true};
+    std::atomic<uint32_t> returnedTrue{0};// count() calls that reported a crossing
+    uint32_t consumed = 0;
+    std::thread reader([&]{
+        while(writing.load(std::memory_order_acquire)){
+            if(counter.finish()){consumed++;}
+        }
+    });
+    std::vector<std::thread> writers;
+    for(int w = 0; w < WRITERS; w++){
+        writers.emplace_back([&]{
+            uint32_t mine = 0;
+            for(int i = 0; i < COUNTS_PER_WRITER; i++){mine += counter.count();}
+            returnedTrue.fetch_add(mine, std::memory_order_relaxed);
+        });
+    }
+    for(auto& t : writers){t.join();}
+    writing.store(false, std::memory_order_release);
+    reader.join();
+    uint32_t inFlight = consumed;
+    while(counter.finish()){consumed++;}// Crossings still pending when the writers stopped
+
+    long long total = (long long)WRITERS * COUNTS_PER_WRITER;
+    printf("cAtomicCount: %d writers x %d counts, goal %d, %u consumed while writing\n", WRITERS, COUNTS_PER_WRITER, GOAL, inFlight);
+    check(consumed == returnedTrue.load(), "crossings == consumed finishes", consumed, returnedTrue.load());
+    check(consumed == total / GOAL, "consumed finishes == total / goal", consumed, total / GOAL);
+    check(counter.get() == total % GOAL, "final count == total % goal", counter.get(), total % GOAL);
+    check(!counter.finish(), "no crossing left", counter.laps(), 0);
+}
+
+static void stressSharded(){
+    cShardedCount<4> counter;
+    std::vector<std::thread> writers;
+    for(int w = 0; w < WRITERS; w++){
+        writers.emplace_back([&]{
+            for(int i = 0; i < COUNTS_PER_WRITER; i++){counter.count();}
+        });
+    }
+    uint32_t taken = 0;
+    for(int i = 0; i < 100; i++){
+        taken += counter.take();
+        std::this_thread::yield();
+    }
+    for(auto& t : writers){t.join();}
+    taken += counter.take();
+    long long total = (long long)WRITERS * COUNTS_PER_WRITER;
+    printf("cShardedCount<4>: %d writers x %d counts\n", WRITERS, COUNTS_PER_WRITER);
+    check(taken == total, "take() sum == total", taken, total);
+}
+
+int main(){
+    stressAtomic();
+    stressSharded();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,83 @@
+/**
+ * @file scheduler_bench.cpp
+ * @brief Host version of the SchedulerExample benchmark: 1,000 timers on cScheduler vs. polling 1,000 cTime objects
+ *
+ * Uses hostClock (steady_clock) and real sleeps, so the loop behaves like the device loop with vTaskDelay().
+ * Absolute numbers depend on the PC; compare the two lines with each other.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <chrono>
+#include <thread>
+#include "Counter.h"
+#include "Scheduler.h"
+
+#define TIMER_COUNT 1000
+#define BENCH_TIME_US 2000000
+
+static uint32_t fired[TIMER_COUNT];
+static cTime pollTimers[TIMER_COUNT];
+
+static void onTimer(void* arg){
+    fired[(intptr_t)arg]++;
+}
+static void sleepMicros(int64_t us){
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+// 1,000 timers on the scheduler - one heap check per loop, sleep until the next deadline
+static void benchScheduler(){
+    cScheduler sched;
+    sched.reserve(TIMER_COUNT);
+    int64_t t0 = counterClock::now();
+    int ids[TIMER_COUNT];
+    for(int i = 0; i < TIMER_COUNT; i++){
+        ids[i] = sched.add(10000 + (i % 100) * 1000, onTimer, (void*)(intptr_t)i);// 10-109 ms periods
+    }
+    int64_t addTime = counterClock::now() - t0;
+
+    uint32_t loops = 0, events = 0;
+    int64_t busy = 0;
+    int64_t end = counterClock::now() + BENCH_TIME_US;
+    while(counterClock::now() < end){
+        int64_t start = counterClock::now();
+        events += sched.run();
+        busy += counterClock::now() - start;
+        loops++;
+        int64_t wait = sched.next();
+        sleepMicros((wait > 1000) ? wait : 1000);
+    }
+    t0 = counterClock::now();
+    for(int i = 0; i < TIMER_COUNT; i++){sched.cancel(ids[i]);}
+    int64_t cancelTime = counterClock::now() - t0;
+    printf("cScheduler:    add %d timers in %lld us (%.3f us/timer), cancel in %lld us\n",
+           TIMER_COUNT, (long long)addTime, (double)addTime / TIMER_COUNT, (long long)cancelTime);
+    printf("cScheduler:    %u events in %u loops, busy %lld us (%.3f us/event)\n",
+           events, loops, (long long)busy, events ? (double)busy / events : 0.0);
+}
+
+// Same workload polling every cTime object on each 1 ms loop
+static void benchPolling(){
+    uint32_t loops = 0, events = 0;
+    int64_t busy = 0;
+    int64_t end = counterClock::now() + BENCH_TIME_US;
+    while(counterClock::now() < end){
+        int64_t start = counterClock::now();
+        for(int i = 0; i < TIMER_COUNT; i++){
+            pollTimers[i].wait(10000 + (i % 100) * 1000);
+            if(pollTimers[i].finish()){events++;}
+        }
+        busy += counterClock::now() - start;
+        loops++;
+        sleepMicros(1000);
+    }
+    printf("cTime polling: %u events in %u loops, busy %lld us (%.3f us/event)\n",
+           events, loops, (long long)busy, events ? (double)busy / events : 0.0);
+}
+
+int main(){
+    printf("=== cScheduler host benchmark (%d timers, %d s per run) ===\n", TIMER_COUNT, BENCH_TIME_US / 1000000);
+    benchScheduler();
+    benchPolling();
+    return 0;
+}
@@ -0,0 +1,114 @@
+/**
+ * @file host_bench.cpp
+ * @brief Host build of the API dispatch benchmark
+ * @version 1.0.0
+ * @date 2026-10-18
+ * @author Eubry Gomez Ramirez
+ *
+ * Build and run from this directory:
+ *   g++ -O2 -std=gnu++17 -I../../../libraries/http/webServer host_bench.cpp -o host_bench && ./host_bench
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <map>
+#include <string>
+#include "jsonDispatch.h"
+
+#ifndef REQUESTS
+#define REQUESTS 1000000
+#endif
+
+struct route {
+    const char* rx;
+    int id;
+};
+
+// Same command set as the device build - "on"/"off" as in the webServer README example
+static const char* COMMANDS[] = {
+    "on", "off", "toggle", "blink", "motor_start", "motor_stop", "set_speed", "set_dir",
+    "beep", "play_melody", "stop_melody", "wifi_scan", "reboot", "status", "get_config", "set_config"
+};
+static const int COMMAND_COUNT = sizeof(COMMANDS) / sizeof(COMMANDS[0]);
+
+// Bodies as a client would send them; several contain a command name inside another word
+static const struct {
+    const char* text;
+    int cmd;// Index in COMMANDS of the "cmd" value - written out, so a parser bug cannot also fix the answer
+} BODIES[] = {
+    {"{\"id\":1,\"cmd\":\"set_speed\",\"value\":128}", 6},
+    {"{\"cmd\":\"status\"}", 13},
+    {"{\"id\":7,\"note\":\"connection test\",\"cmd\":\"blink\",\"times\":3}", 3},
+    {"{\"cmd\":\"off\",\"source\":\"button\"}", 1},
+    {"{\"id\":42,\"cmd\":\"play_melody\",\"melody\":\"intro\",\"tempo\":120}", 9},
+    {"{\"options\":{\"retry\":true},\"cmd\":\"set_config\",\"ssid\":\"station\"}", 15},
+    {"{\"cmd\":\"reboot\",\"delay\":500}", 12},
+    {"{\"cmd\":\"motor_stop\",\"reason\":\"obstacle detected\"}", 5}
+};
+static const int BODY_COUNT = sizeof(BODIES) / sizeof(BODIES[0]);
+
+static double elapsed(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Runs both dispatchers over the bodies with the first 16 real commands plus `extra` filler routes
+static void run(int extra) {
+    static char names[256][16];
+    std::map<std::string, route> options;
+    dispatchTable<int> table;
+    for (int i = 0; i < COMMAND_COUNT + extra; i++) {
+        const char* name = COMMANDS[i % COMMAND_COUNT];
+        if (i >= COMMAND_COUNT) {
+            snprintf(names[i], sizeof(names[i]), "route_%03d", i);
+            name = names[i];
+        }
+        options[name] = {name, i};
+        table.add(name, i);
+    }
+    table.build();
+
+    printf("--- %d routes ---\n", COMMAND_COUNT + extra);
+
+    // Legacy: strstr of every option over the body, first hit in key order wins
+    unsigned long wrong = 0;
+    long checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < REQUESTS; r++) {
+        const char* body = BODIES[r % BODY_COUNT].text;
+        int hit = -1;
+        for (const auto& [key, option] : options) {
+            if (strstr(body, option.rx) != NULL) {hit = option.id; break;}
+        }
+        if (hit != BODIES[r % BODY_COUNT].cmd) {wrong++;}
+        checksum += hit;
+    }
+    double legacy = elapsed(start);
+    printf("strstr scan:          %10.0f req/s, wrong route %lu (%.0f%%)\n",
+           REQUESTS / legacy, wrong, 100.0 * wrong / REQUESTS);
+
+    // JSON mode: extract "cmd" in one pass, then binary search on its hash
+    wrong = 0;
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < REQUESTS; r++) {
+        const char* body = BODIES[r % BODY_COUNT].text;
+        jsonField field("cmd");
+        field.feed(body, strlen(body));
+        const int* id = field.found() ? table.find(field.value(), field.length()) : nullptr;
+        int hit = id ? *id : -1;
+        if (hit != BODIES[r % BODY_COUNT].cmd) {wrong++;}
+        checksum += hit;
+    }
+    double json = elapsed(start);
+    printf("jsonField + table:    %10.0f req/s, wrong route %lu\n", REQUESTS / json, wrong);
+    printf("speedup %.1fx (checksum %ld)\n", legacy / json, checksum);
+}
+
+int main() {
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    printf("=== API dispatch benchmark (host, %d requests per test) ===\n", REQUESTS);
+    run(0);
+    run(48);
+    run(240);
+    return 0;
+}
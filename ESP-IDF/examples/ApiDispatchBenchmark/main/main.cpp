@@ -0,0 +1,119 @@
+/**
+ * @file main.cpp
+ * @brief Request dispatch benchmark: strstr option scan vs. JSON field + hash table
+ * @version 1.0.0
+ * @date 2026-10-18
+ * @author Eubry Gomez Ramirez
+ *
+ * This example demonstrates:
+ * - jsonField extracting "cmd" from a request body in one pass, without allocation
+ * - dispatchTable lookups (binary search on precomputed hashes)
+ * - Wrong routes picked by the legacy substring scan ("on" inside "connection")
+ * - Benchmark: requests/second with 16, 64 and 256 routes
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "jsonDispatch.h"
+
+#define REQUESTS 5000// Keeps each test well under the 5 s task watchdog
+
+// Tag for logging
+static const char *TAG = "ApiDispatchBenchmark";
+
+struct route {
+    const char* rx;
+    int id;
+};
+
+// "on"/"off" as in the webServer README example
+static const char* COMMANDS[] = {
+    "on", "off", "toggle", "blink", "motor_start", "motor_stop", "set_speed", "set_dir",
+    "beep", "play_melody", "stop_melody", "wifi_scan", "reboot", "status", "get_config", "set_config"
+};
+static const int COMMAND_COUNT = sizeof(COMMANDS) / sizeof(COMMANDS[0]);
+
+// Several bodies contain a command name inside another word
+static const struct {
+    const char* text;
+    int cmd;// Index in COMMANDS of the "cmd" value - written out, so a parser bug cannot also fix the answer
+} BODIES[] = {
+    {"{\"id\":1,\"cmd\":\"set_speed\",\"value\":128}", 6},
+    {"{\"cmd\":\"status\"}", 13},
+    {"{\"id\":7,\"note\":\"connection test\",\"cmd\":\"blink\",\"times\":3}", 3},
+    {"{\"cmd\":\"off\",\"source\":\"button\"}", 1},
+    {"{\"id\":42,\"cmd\":\"play_melody\",\"melody\":\"intro\",\"tempo\":120}", 9},
+    {"{\"options\":{\"retry\":true},\"cmd\":\"set_config\",\"ssid\":\"station\"}", 15},
+    {"{\"cmd\":\"reboot\",\"delay\":500}", 12},
+    {"{\"cmd\":\"motor_stop\",\"reason\":\"obstacle detected\"}", 5}
+};
+static const int BODY_COUNT = sizeof(BODIES) / sizeof(BODIES[0]);
+
+static char names[256][16];
+
+/**
+ * @brief Runs both dispatchers with the 16 real commands plus `extra` filler routes
+ */
+static void runBench(int extra) {
+    std::map<std::string, route> options;
+    dispatchTable<int> table;
+    for (int i = 0; i < COMMAND_COUNT + extra; i++) {
+        const char* name = COMMANDS[i % COMMAND_COUNT];
+        if (i >= COMMAND_COUNT) {
+            snprintf(names[i], sizeof(names[i]), "route_%03d", i);
+            name = names[i];
+        }
+        options[name] = {name, i};
+        table.add(name, i);
+    }
+    table.build();
+
+    // Legacy: strstr of every option over the body, first hit in key order wins
+    uint32_t wrong = 0;
+    int64_t start = esp_timer_get_time();
+    for (int r = 0; r < REQUESTS; r++) {
+        const char* body = BODIES[r % BODY_COUNT].text;
+        int hit = -1;
+        for (const auto& [key, option] : options) {
+            if (strstr(body, option.rx) != NULL) {hit = option.id; break;}
+        }
+        if (hit != BODIES[r % BODY_COUNT].cmd) {wrong++;}
+    }
+    int64_t legacy = esp_timer_get_time() - start;
+    ESP_LOGI(TAG, "%3d routes  strstr scan:       %7lu req/s, wrong route %lu",
+             COMMAND_COUNT + extra, (unsigned long)(REQUESTS * 1000000LL / legacy), (unsigned long)wrong);
+
+    // JSON mode: extract "cmd" in one pass, then binary search on its hash
+    wrong = 0;
+    start = esp_timer_get_time();
+    for (int r = 0; r < REQUESTS; r++) {
+        const char* body = BODIES[r % BODY_COUNT].text;
+        jsonField field("cmd");
+        field.feed(body, strlen(body));
+        const int* id = field.found() ? table.find(field.value(), field.length()) : nullptr;
+        if ((id ? *id : -1) != BODIES[r % BODY_COUNT].cmd) {wrong++;}
+    }
+    int64_t json = esp_timer_get_time() - start;
+    ESP_LOGI(TAG, "%3d routes  jsonField + table: %7lu req/s, wrong route %lu",
+             COMMAND_COUNT + extra, (unsigned long)(REQUESTS * 1000000LL / json), (unsigned long)wrong);
+}
+
+/**
+ * @brief Main application entry point
+ */
+extern "C" void app_main(void)
+{
+    ESP_LOGI(TAG, "=== API Dispatch Benchmark (%d requests per test) ===", REQUESTS);
+    runBench(0);
+    vTaskDelay(1);// Let the idle task run between tests
+    runBench(48);
+    vTaskDelay(1);
+    runBench(240);
+    ESP_LOGI(TAG, "Done");
+}
@@ -0,0 +1,193 @@
+/**
+ * @file host_bench.cpp
+ * @brief Host build of the channel benchmark (std::thread instead of FreeRTOS tasks)
+ * @version 1.0.0
+ * @date 2026-10-18
+ * @author Eubry Gomez Ramirez
+ *
+ * Build and run from this directory:
+ *   g++ -O2 -std=gnu++17 -pthread -I../../../libraries/Utils host_bench.cpp -o host_bench && ./host_bench
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+#include "Channel.h"
+
+#ifndef MESSAGES
+#define MESSAGES 5000000
+#endif
+
+struct sample {
+    uint32_t seq;
+    int32_t value;
+    int64_t timestamp;
+};
+
+static double elapsed(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void report(const char* name, uint64_t messages, double seconds) {
+    printf("%-28s %10.0f msg/s (%llu msgs, %.3f s)\n", name, messages / seconds, (unsigned long long)messages, seconds);
+}
+
+static void benchSpsc() {
+    static Utils::spscChannel<sample, 1024> channel;
+    auto start = std::chrono::steady_clock::now();
+    std::thread producer([] {
+        for (uint32_t i = 0; i < MESSAGES;) {
+            sample* slot = channel.claim();// Zero-copy: fill the ring slot in place
+            if (slot == nullptr) {std::this_thread::yield(); continue;}
+            slot->seq = i++;
+            slot->value = (int32_t)i;
+            slot->timestamp = 0;
+            channel.commit();
+        }
+    });
+    uint32_t expected = 0, errors = 0;
+    while (expected < MESSAGES) {
+        const sample* slot = channel.peek();
+        if (slot == nullptr) {std::this_thread::yield(); continue;}
+        if (slot->seq != expected) {errors++;}
+        expected++;
+        channel.release();
+    }
+    producer.join();
+    report("spscChannel claim/peek", MESSAGES, elapsed(start));
+    if (errors) {printf("  ordering errors: %lu\n", (unsigned long)errors);}
+}
+
+static void benchMpmc(int producers, int consumers) {
+    static Utils::mpmcChannel<sample, 1024> channel;
+    std::atomic<uint64_t> received{0};
+    std::atomic<uint64_t> checksum{0};
+    uint32_t perProducer = MESSAGES / producers;
+    uint64_t total = (uint64_t)perProducer * producers;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&, p] {
+            for (uint32_t i = 0; i < perProducer;) {
+                if (channel.push({i, p, 0})) {i++;} else {std::this_thread::yield();}
+            }
+        });
+    }
+    for (int c = 0; c < consumers; c++) {
+        threads.emplace_back([&] {
+            sample item;
+            uint64_t sum = 0;
+            while (received.load(std::memory_order_relaxed) < total) {
+                if (channel.pop(item)) {
+                    sum += item.seq;
+                    received.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+            checksum.fetch_add(sum);
+        });
+    }
+    for (auto& t : threads) {t.join();}
+    char name[40];
+    snprintf(name, sizeof(name), "mpmcChannel %dP/%dC", producers, consumers);
+    report(name, total, elapsed(start));
+    uint64_t expectedSum = (uint64_t)producers * ((uint64_t)perProducer * (perProducer - 1) / 2);
+    if (checksum != expectedSum) {printf("  checksum mismatch\n");}
+}
+
+static void benchMutexQueue() {
+    std::mutex lock;
+    std::queue<sample> queue;
+    auto start = std::chrono::steady_clock::now();
+    std::thread producer([&] {
+        for (uint32_t i = 0; i < MESSAGES;) {
+            std::lock_guard<std::mutex> guard(lock);
+            if (queue.size() < 1024) {queue.push({i++, 0, 0});} else {std::this_thread::yield();}
+        }
+    });
+    uint32_t count = 0;
+    while (count < MESSAGES) {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!queue.empty()) {
+            queue.pop();
+            count++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    report("std::mutex + std::queue", MESSAGES, elapsed(start));
+}
+
+static void benchSeqCell() {
+    static Utils::seqCell<sample> cell;
+    std::atomic<bool> running{true};
+    uint64_t reads = 0, torn = 0;
+    auto start = std::chrono::steady_clock::now();
+    std::thread writer([&] {
+        for (uint32_t i = 0; i < MESSAGES; i++) {
+            cell.write({i, (int32_t)i, (int64_t)i * 3});
+        }
+        running = false;
+    });
+    while (running) {
+        sample s = cell.read();
+        if (s.value != (int32_t)s.seq || s.timestamp != (int64_t)s.seq * 3) {torn++;}
+        reads++;
+    }
+    writer.join();
+    double seconds = elapsed(start);
+    report("seqCell writes", MESSAGES, seconds);
+    report("seqCell reads (concurrent)", reads, seconds);
+    if (torn) {printf("  torn reads: %llu\n", (unsigned long long)torn);}
+}
+
+static void benchTopic() {
+    static Utils::topicBus<sample, 4, 256> topic;
+    int subs[3] = {topic.subscribe(), topic.subscribe(), topic.subscribe()};
+    std::atomic<bool> running{true};
+    std::atomic<uint64_t> received{0};
+    std::vector<std::thread> threads;
+    for (int id : subs) {
+        threads.emplace_back([&, id] {
+            sample item;
+            while (true) {
+                if (topic.receive(id, item)) {
+                    received.fetch_add(1, std::memory_order_relaxed);
+                } else if (!running) {
+                    break;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < MESSAGES / 5; i++) {
+        topic.publish({i, 0, 0});
+    }
+    running = false;
+    for (auto& t : threads) {t.join();}
+    double seconds = elapsed(start);
+    report("topicBus publish (3 subs)", topic.published(), seconds);
+    printf("  delivered %llu, dropped %lu/%lu/%lu\n", (unsigned long long)received.load(),
+           (unsigned long)topic.dropped(subs[0]), (unsigned long)topic.dropped(subs[1]), (unsigned long)topic.dropped(subs[2]));
+}
+
+int main() {
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    printf("=== Channel benchmark (host, %u hardware threads) ===\n", std::thread::hardware_concurrency());
+    benchSpsc();
+    benchMpmc(1, 1);
+    benchMpmc(2, 2);
+    benchMutexQueue();
+    benchSeqCell();
+    benchTopic();
+    return 0;
+}
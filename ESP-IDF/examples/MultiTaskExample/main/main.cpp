@@ -8,7 +8,7 @@
  * This example demonstrates:
  * - Creating multiple FreeRTOS tasks with different priorities
  * - Pinning tasks to specific CPU cores
- * - Inter-task communication using shared data
+ * - Inter-task communication with a seqCell latest-value snapshot
  * - Different task patterns (periodic, event-driven)
  */
 
@@ -18,6 +18,7 @@
 #include "driver/gpio.h"
 #include "esp_log.h"
 #include "Utils.h"
+#include "Channel.h"
 
 // GPIO pins
 #define LED_PIN GPIO_NUM_2
@@ -29,9 +30,14 @@ static const char *TAG_SENSOR = "SensorTask";
 static const char *TAG_LED = "LEDTask";
 static const char *TAG_MONITOR = "MonitorTask";
 
-// Shared data (protected by FreeRTOS scheduler)
-volatile int sensorValue = 0;
-volatile int taskCounter = 0;
+// Latest sensor snapshot - written by the sensor task, read by everyone else without locks
+struct sensorSnapshot {
+    int value;
+    uint32_t readings;
+    TickType_t tick;
+};
+Utils::seqCell<sensorSnapshot> sensor;
+int taskCounter = 0;// Only touched by the monitor task
 
 // Task manager instance
 Utils::taskManager tasks;
@@ -44,13 +50,14 @@ void sensorTask(void* param) {
     ESP_LOGI(TAG_SENSOR, "Sensor task started on Core %d", xPortGetCoreID());
     
     int reading = 0;
+    uint32_t readings = 0;
     while(1) {
         // Simulate sensor reading (random value 0-100)
         reading = (reading + 1) % 101;
-        sensorValue = reading;
+        sensor.write({reading, ++readings, xTaskGetTickCount()});
         
         if (reading % 20 == 0) {
-            ESP_LOGI(TAG_SENSOR, "Sensor reading: %d", sensorValue);
+            ESP_LOGI(TAG_SENSOR, "Sensor reading: %d", reading);
         }
         
         tasks.resetWatchdog("sensorTask");
@@ -69,7 +76,7 @@ void ledControlTask(void* param) {
     
     while(1) {
         // LED blink rate based on sensor value
-        if (sensorValue > 50) {
+        if (sensor.read().value > 50) {
             // Fast blink for high values
             gpio_set_level(LED_PIN, 1);
             vTaskDelay(pdMS_TO_TICKS(100));
@@ -100,7 +107,9 @@ void monitorTask(void* param) {
         // Log system status every 5 seconds
         ESP_LOGI(TAG_MONITOR, "=== System Status ===");
         ESP_LOGI(TAG_MONITOR, "Uptime: %lu seconds", taskCounter * 5);
-        ESP_LOGI(TAG_MONITOR, "Current sensor value: %d", sensorValue);
+        sensorSnapshot snap = sensor.read();// value, count and tick always belong together
+        ESP_LOGI(TAG_MONITOR, "Current sensor value: %d (reading #%lu, %lu ms ago)", snap.value, snap.readings,
+                 (unsigned long)pdTICKS_TO_MS(xTaskGetTickCount() - snap.tick));
         ESP_LOGI(TAG_MONITOR, "Free heap: %lu bytes", esp_get_free_heap_size());
         ESP_LOGI(TAG_MONITOR, "Min free heap: %lu bytes", esp_get_minimum_free_heap_size());
         ESP_LOGI(TAG_MONITOR, "====================\n");
@@ -120,9 +129,10 @@ void computeTask(void* param) {
     uint32_t computeResult = 0;
     
     while(1) {
-        // Simulate some computation
+        // Simulate some computation on one consistent snapshot
+        int value = sensor.read().value;
         for (int i = 0; i < 1000; i++) {
-            computeResult += i * sensorValue;
+            computeResult += i * value;
         }
         
         // Log result occasionally
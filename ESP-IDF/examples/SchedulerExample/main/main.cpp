@@ -0,0 +1,107 @@
+/**
+ * @file main.cpp
+ * @brief cScheduler example and 1,000-timer benchmark
+ * @version 1.0.0
+ * @date 2026-10-18
+ * @author Eubry Gomez Ramirez
+ * 
+ * This example demonstrates:
+ * - Registering many software timers with callbacks on one cScheduler
+ * - Sleeping until the next deadline instead of polling every timer
+ * - Benchmark: 1,000 timers with cScheduler vs. polling 1,000 cTime objects
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "Counter.h"
+#include "Scheduler.h"
+
+#define TIMER_COUNT 1000
+#define BENCH_TIME_US 2000000
+
+// Tag for logging
+static const char *TAG = "SchedulerExample";
+
+static uint32_t fired[TIMER_COUNT];
+static cTime pollTimers[TIMER_COUNT];
+
+void onTimer(void* arg) {
+    fired[(intptr_t)arg]++;
+}
+
+/**
+ * @brief 1,000 timers on the scheduler - one heap check per loop, sleep until next deadline
+ */
+void benchScheduler() {
+    cScheduler sched;
+    sched.reserve(TIMER_COUNT);
+
+    int64_t t0 = esp_timer_get_time();
+    for (int i = 0; i < TIMER_COUNT; i++) {
+        sched.add(10000 + (i % 100) * 1000, onTimer, (void*)(intptr_t)i);// 10-109 ms periods
+    }
+    int64_t addTime = esp_timer_get_time() - t0;
+
+    uint32_t loops = 0, events = 0;
+    int64_t busy = 0;
+    int64_t end = esp_timer_get_time() + BENCH_TIME_US;
+    while (esp_timer_get_time() < end) {
+        int64_t start = esp_timer_get_time();
+        events += sched.run();
+        busy += esp_timer_get_time() - start;
+        loops++;
+        int64_t wait = sched.next();
+        vTaskDelay((wait > 1000) ? pdMS_TO_TICKS(wait / 1000) : 1);
+    }
+    ESP_LOGI(TAG, "cScheduler: add %d timers in %lld us (%.2f us/timer)", TIMER_COUNT, addTime, (double)addTime / TIMER_COUNT);
+    ESP_LOGI(TAG, "cScheduler: %lu events in %lu loops, busy %lld us (%.2f us/event)",
+             events, loops, busy, events ? (double)busy / events : 0.0);
+}
+
+/**
+ * @brief Same workload polling every cTime object on each 1 ms loop
+ */
+void benchPolling() {
+    uint32_t loops = 0, events = 0;
+    int64_t busy = 0;
+    int64_t end = esp_timer_get_time() + BENCH_TIME_US;
+    while (esp_timer_get_time() < end) {
+        int64_t start = esp_timer_get_time();
+        for (int i = 0; i < TIMER_COUNT; i++) {
+            pollTimers[i].wait(10000 + (i % 100) * 1000);
+            if (pollTimers[i].finish()) {
+                events++;
+            }
+        }
+        busy += esp_timer_get_time() - start;
+        loops++;
+        vTaskDelay(1);
+    }
+    ESP_LOGI(TAG, "cTime polling: %lu events in %lu loops, busy %lld us (%.2f us/event)",
+             events, loops, busy, events ? (double)busy / events : 0.0);
+}
+
+/**
+ * @brief Main application entry point
+ */
+extern "C" void app_main(void)
+{
+    ESP_LOGI(TAG, "=== cScheduler Example (%d timers) ===", TIMER_COUNT);
+    benchScheduler();
+    benchPolling();
+
+    // Typical use: a few periodic jobs sharing one loop
+    cScheduler sched;
+    sched.add(500000, [](void*) { ESP_LOGI(TAG, "500 ms tick"); });
+    sched.add(2000000, [](void*) { ESP_LOGI(TAG, "2 s tick"); });
+    sched.add(5000000, [](void*) { ESP_LOGI(TAG, "one-shot after 5 s"); }, nullptr, false);
+    while (1) {
+        sched.run();
+        int64_t wait = sched.next();
+        vTaskDelay((wait > 1000) ? pdMS_TO_TICKS(wait / 1000) : 1);
+    }
+}
@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+"""
+Load tester for serverManager: N concurrent clients, latency percentiles.
+
+Standard library only. Every worker thread owns one connection and sends
+requests back to back for --duration seconds. With --close every request
+opens a new TCP connection (the cost a browser pays without keep-alive).
+
+    python3 loadtest.py http://192.168.1.50/ --concurrency 1,4,8,16
+    python3 loadtest.py http://192.168.1.50/api/cmd --body '{"cmd":"status"}'
+    python3 loadtest.py http://192.168.1.50/ --close --concurrency 8
+    python3 loadtest.py http://192.168.1.50/ --slow http://192.168.1.50/api/slow --slow-clients 2
+
+With --slow, that many extra clients hammer a slow endpoint during every
+level, and a second line reports them; the first line shows what the slow
+requests cost everybody else.
+"""
+import argparse
+import http.client
+import socket
+import threading
+import time
+from urllib.parse import urlsplit
+
+
+def percentile(sorted_values, p):
+    if not sorted_values:
+        return float("nan")
+    k = (len(sorted_values) - 1) * p / 100.0
+    lo = int(k)
+    hi = min(lo + 1, len(sorted_values) - 1)
+    return sorted_values[lo] + (sorted_values[hi] - sorted_values[lo]) * (k - lo)
+
+
+class Worker(threading.Thread):
+    def __init__(self, url, body, close, timeout, deadline):
+        super().__init__(daemon=True)
+        self.url = url
+        self.body = body.encode() if body is not None else None
+        self.close = close
+        self.timeout = timeout
+        self.deadline = deadline
+        self.latencies = []
+        self.errors = {}
+        self.connects = 0
+
+    def connect(self):
+        self.connects += 1
+        conn = http.client.HTTPConnection(self.url.hostname, self.url.port or 80, timeout=self.timeout)
+        conn.connect()
+        # Headers and body go out as separate writes; Nagle would hold the body for a delayed ACK
+        conn.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        return conn
+
+    def error(self, name):
+        self.errors[name] = self.errors.get(name, 0) + 1
+
+    def run(self):
+        path = self.url.path or "/"
+        method = "POST" if self.body is not None else "GET"
+        headers = {"Connection": "close" if self.close else "keep-alive"}
+        if self.body is not None:
+            headers["Content-Type"] = "application/json"
+        conn = None
+        while time.monotonic() < self.deadline:
+            start = time.perf_counter()
+            try:
+                if conn is None:
+                    conn = self.connect()
+                conn.request(method, path, body=self.body, headers=headers)
+                resp = conn.getresponse()
+                resp.read()
+                elapsed = time.perf_counter() - start
+                if resp.status >= 400:
+                    self.error("HTTP %d" % resp.status)
+                else:
+                    self.latencies.append(elapsed)
+                if self.close or resp.will_close:
+                    conn.close()
+                    conn = None
+            except (OSError, http.client.HTTPException) as e:
+                self.error(type(e).__name__)
+                if conn is not None:
+                    conn.close()
+                conn = None
+                time.sleep(0.05)  # Do not spin on a refused connection
+        if conn is not None:
+            conn.close()
+
+
+def report(label, workers, wall):
+    latencies = sorted(l for w in workers for l in w.latencies)
+    errors = {}
+    for w in workers:
+        for name, count in w.errors.items():
+            errors[name] = errors.get(name, 0) + count
+    connects = sum(w.connects for w in workers)
+    ms = [percentile(latencies, p) * 1000 for p in (50, 90, 99)]
+    worst = latencies[-1] * 1000 if latencies else float("nan")
+    print("%5s %9.1f %8.1f %8.1f %8.1f %8.1f %9d %s" % (
+        label, len(latencies) / wall, ms[0], ms[1], ms[2], worst, connects,
+        ", ".join("%s %d" % e for e in sorted(errors.items())) or "-"))
+
+
+def run(url, body, close, concurrency, duration, timeout, slow):
+    deadline = time.monotonic() + duration
+    workers = [Worker(url, body, close, timeout, deadline) for _ in range(concurrency)]
+    slow_workers = [Worker(slow[0], slow[1], close, timeout, deadline) for _ in range(slow[2])] if slow else []
+    started = time.monotonic()
+    for w in workers + slow_workers:
+        w.start()
+    for w in workers + slow_workers:
+        w.join()
+    wall = time.monotonic() - started
+    report(str(concurrency), workers, wall)
+    if slow_workers:
+        report("slow", slow_workers, wall)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("url", help="e.g. http://192.168.1.50/ or http://esp32-load.local/api/cmd")
+    parser.add_argument("--concurrency", default="1,4,8", help="comma separated client counts (default 1,4,8)")
+    parser.add_argument("--duration", type=float, default=10.0, help="seconds per concurrency level (default 10)")
+    parser.add_argument("--body", default=None, help="POST this JSON body instead of GET")
+    parser.add_argument("--close", action="store_true", help="new TCP connection for every request")
+    parser.add_argument("--timeout", type=float, default=5.0, help="socket timeout in seconds (default 5)")
+    parser.add_argument("--slow", default=None, help="slow endpoint loaded in the background of every level")
+    parser.add_argument("--slow-body", default=None, help="POST this JSON body to the slow endpoint")
+    parser.add_argument("--slow-clients", type=int, default=1, help="clients on the slow endpoint (default 1)")
+    args = parser.parse_args()
+    slow = (urlsplit(args.slow), args.slow_body, args.slow_clients) if args.slow else None
+
+    url = urlsplit(args.url)
+    print("%s %s, %s, %.0f s per level" % ("POST" if args.body else "GET", args.url,
+          "connection per request" if args.close else "keep-alive", args.duration))
+    if slow:
+        print("background: %d client(s) on %s" % (args.slow_clients, args.slow))
+    print("%5s %9s %8s %8s %8s %8s %9s %s" % ("conc", "req/s", "p50 ms", "p90 ms", "p99 ms", "max ms", "connects", "errors"))
+    for level in args.concurrency.split(","):
+        run(url, args.body, args.close, int(level), args.duration, args.timeout, slow)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,137 @@
+/**
+ * @file main.cpp
+ * @brief serverManager tuning profiles for load testing with host/loadtest.py
+ * @version 1.0.0
+ * @date 2026-10-18
+ * @author Eubry Gomez Ramirez
+ *
+ * This example demonstrates:
+ * - setMaxConnections, setBacklog, setTimeout, setStackSize, setTaskPriority, setCoreID
+ * - setLruPurge and setKeepAlive for many short-lived or idle clients
+ * - An HTML route and a JSON API route to measure with the host load tester
+ * - A slow endpoint (motor ramp) run on the httpd task or on the Utils worker pool (ASYNC)
+ * - Per-client rate limits and a control lane for /api/cmd (LIMIT)
+ * - Free heap and connection settings logged while the test runs
+ */
+
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "Utils.h"
+#include "wifiManager.h"
+#include "webManager.h"
+
+// WiFi credentials - CHANGE THESE TO YOUR NETWORK
+#define WIFI_SSID "YourWiFiSSID"
+#define WIFI_PASSWORD "YourWiFiPassword"
+#define WIFI_HOSTNAME "esp32-load"
+#define MAX_RETRY 5
+
+// 0: HTTPD_DEFAULT_CONFIG, 1: many clients, 2: many clients + pinned high-priority task
+#define PROFILE 1
+// 0: /api/slow blocks the httpd task, 1: it runs on the worker pool
+#define ASYNC 1
+#define SLOW_MS 250// Simulated motor ramp
+// 0: no admission control, 1: 20 req/s per client, /api/cmd in the control lane
+#define LIMIT 0
+
+// Tag for logging
+static const char *TAG = "ServerLoadTest";
+
+static const char PAGE[] =
+    "<html><head><title>ESP32</title></head>"
+    "<body><h1>ESP32 load test</h1><p>serverManager tuning profile</p></body></html>";
+
+static Utils::taskManager tasks;
+
+/**
+ * @brief Stands in for a motor ramp or sensor sweep - blocks whichever task runs it
+ */
+static void rampMotor(void* parameter) {
+    vTaskDelay(pdMS_TO_TICKS(SLOW_MS));
+}
+
+/**
+ * @brief Applies the selected tuning profile before begin()
+ */
+static void applyProfile(serverManager& web) {
+#if PROFILE >= 1
+    web.setMaxConnections(13);      // Needs CONFIG_LWIP_MAX_SOCKETS=16
+    web.setBacklog(8);              // Bursts of new connections wait instead of being refused
+    web.setTimeout(3000);           // Stalled clients free their socket sooner
+    web.setStackSize(6144);
+    web.setLruPurge(true);          // A new client evicts the least recently used session
+    web.setKeepAlive(true, 5, 2, 3);// Dead clients are detected after ~11 s instead of never
+#endif
+#if PROFILE >= 2
+    web.setTaskPriority(tskIDLE_PRIORITY + 6);
+    web.setCoreID(1);               // Keep the server away from the WiFi task on core 0
+#endif
+}
+
+/**
+ * @brief Main application entry point
+ */
+extern "C" void app_main(void)
+{
+    ESP_LOGI(TAG, "=== Server Load Test (profile %d) ===", PROFILE);
+
+    wifiConnection wifi(WIFI_SSID, WIFI_PASSWORD, MAX_RETRY, WIFI_HOSTNAME);
+    if (wifi.begin(WIFI_MODE_STA) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to connect to WiFi!");
+        return;
+    }
+
+    static serverManager web;// Outlives app_main
+    applyProfile(web);
+
+    serverManager::webData root = {
+        .uri = "/",
+        .html = PAGE,
+        .status = "200 OK",
+        .error = ""
+    };
+    web.addHTMLPath("root", HTTP_GET, root);
+
+    serverManager::apiData api;
+    api.uri = "api/cmd";
+    api.field = "cmd";
+    api.option["status"] = {.rx = "status", .tx = "{\"ok\":true,\"uptime\":1}"};
+    api.option["led_on"] = {.rx = "led_on", .tx = "{\"led\":true}"};
+    web.addAPIPath("cmd", api);
+
+    serverManager::apiData slow;
+    slow.uri = "api/slow";
+    slow.field = "cmd";
+    slow.option["ramp"] = {.rx = "ramp", .tx = "{\"ramped\":true}", .handler = rampMotor, .async = (ASYNC != 0)};
+    web.addAPIPath("slow", slow);
+#if ASYNC
+    tasks.startPool(1, 5, 4096, 16);// One worker per core
+    web.setWorkers(&tasks, 4);      // 4 ramps in flight at most, the 5th client gets 503
+#endif
+#if LIMIT
+    web.setClientLimit(20, 40);     // One load tester is one client: expect 429s above 20 req/s
+    web.setLane("/api/cmd", WEB_LANE_CONTROL);
+#endif
+    web.enableMetrics();            // Per-route latency histograms at /metrics
+
+    if (web.begin() == NULL) {
+        ESP_LOGE(TAG, "Server did not start - check CONFIG_LWIP_MAX_SOCKETS against setMaxConnections");
+        return;
+    }
+    ESP_LOGI(TAG, "Run: python3 host/loadtest.py http://%s/ --concurrency 1,4,8,16", wifi.getIp().c_str());
+    ESP_LOGI(TAG, "Slow endpoint: add --slow http://%s/api/slow --slow-body '{\"cmd\":\"ramp\"}' --slow-clients 2",
+             wifi.getIp().c_str());
+    ESP_LOGI(TAG, "Server-side latency: curl -s http://%s/metrics | grep duration", wifi.getIp().c_str());
+
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(5000));
+        serverManager::asyncStats async = web.getAsyncStats();
+        ESP_LOGI(TAG, "Free heap %u, minimum %u, async accepted %lu rejected %lu peak %u",
+                 (unsigned)heap_caps_get_free_size(MALLOC_CAP_8BIT),
+                 (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT),
+                 (unsigned long)async.accepted, (unsigned long)async.rejected, async.peak);
+    }
+}
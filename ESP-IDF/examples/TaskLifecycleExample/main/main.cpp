@@ -8,7 +8,8 @@
  * This example demonstrates:
  * - Dynamic task creation during runtime
  * - Safe task deletion with cleanup
- * - Using inMap() to check task existence
+ * - Cooperative cancellation with shouldStop() and join()
+ * - Tasks that simply return and are removed automatically
  * - Task state management
  * - Practical use case: On-demand task spawning
  */
@@ -53,11 +54,7 @@ void workerTask1(void* param) {
     
     ESP_LOGI(TAG, "Worker Task %d completed its work", *workerId);
     runningTask1 = false;
-    
-    // Task will be deleted by management loop
-    while(1) {
-        vTaskDelay(pdMS_TO_TICKS(1000));
-    }
+    // Returning is safe: taskManager deletes the task and removes it from its map
 }
 
 /**
@@ -71,20 +68,16 @@ void workerTask2(void* param) {
     gpio_set_direction(LED_PIN, GPIO_MODE_OUTPUT);
     
     // Blink LED for 10 seconds
-    for (int i = 0; i < 20; i++) {
+    for (int i = 0; i < 20 && !Utils::taskManager::cancelled(); i++) {
         gpio_set_level(LED_PIN, i % 2);
         ESP_LOGI(TAG, "Worker %d: LED %s", *workerId, (i % 2) ? "ON" : "OFF");
         tasks.resetWatchdog("worker2");
         vTaskDelay(pdMS_TO_TICKS(500));
     }
     
-    gpio_set_level(LED_PIN, 0);
+    gpio_set_level(LED_PIN, 0);// Always leave the LED off, even when cancelled
     ESP_LOGI(TAG, "Worker Task %d completed its work", *workerId);
     runningTask2 = false;
-    
-    while(1) {
-        vTaskDelay(pdMS_TO_TICKS(1000));
-    }
 }
 
 /**
@@ -96,18 +89,15 @@ void workerTask3(void* param) {
     runningTask3 = true;
     
     int counter = 0;
-    while(runningTask3) {
+    // shouldStop() doubles as the loop delay and returns early once del() cancels the task
+    while(!Utils::taskManager::shouldStop(pdMS_TO_TICKS(1000))) {
         counter++;
         ESP_LOGI(TAG, "Worker %d: Monitoring... (count: %d)", *workerId, counter);
         tasks.resetWatchdog("worker3");
-        vTaskDelay(pdMS_TO_TICKS(1000));
     }
     
     ESP_LOGI(TAG, "Worker Task %d shutting down", *workerId);
-    
-    while(1) {
-        vTaskDelay(pdMS_TO_TICKS(1000));
-    }
+    runningTask3 = false;
 }
 
 /**
@@ -148,34 +138,26 @@ void taskManagerTask(void* param) {
             tasks.add("worker3", workerTask3, &workerId3, 3, 1, 3072);
         }
         
-        // Cycle 7: Delete worker1 if finished
-        if (cycle == 7 && !runningTask1) {
-            ESP_LOGI(TAG, "→ Deleting Worker Task 1 (completed)");
-            tasks.del("worker1");
+        // Cycle 7: Worker1 returned on its own - join() confirms it is gone
+        if (cycle == 7) {
+            ESP_LOGI(TAG, "→ Joining Worker Task 1: %s", tasks.join("worker1", 0) ? "finished" : "still running");
         }
         
-        // Cycle 9: Delete worker2 if finished
-        if (cycle == 9 && !runningTask2) {
-            ESP_LOGI(TAG, "→ Deleting Worker Task 2 (completed)");
-            tasks.del("worker2");
+        // Cycle 9: Wait for worker2 to finish its blink sequence
+        if (cycle == 9) {
+            ESP_LOGI(TAG, "→ Joining Worker Task 2");
+            tasks.join("worker2", pdMS_TO_TICKS(10000));
         }
         
-        // Cycle 11: Stop and delete worker3
+        // Cycle 11: Cancel worker3 and wait for it to return
         if (cycle == 11) {
             ESP_LOGI(TAG, "→ Stopping Worker Task 3");
-            runningTask3 = false;
-            vTaskDelay(pdMS_TO_TICKS(2000));
-            ESP_LOGI(TAG, "→ Deleting Worker Task 3");
-            tasks.del("worker3");
+            tasks.del("worker3", pdMS_TO_TICKS(2000));
         }
         
         // Cycle 13: Create all tasks again
         if (cycle == 13) {
             ESP_LOGI(TAG, "→ Restarting all worker tasks");
-            runningTask1 = false;
-            runningTask2 = false;
-            runningTask3 = true;
-            
             tasks.add("worker1", workerTask1, &workerId1, 5, 1, 3072);
             vTaskDelay(pdMS_TO_TICKS(1000));
             tasks.add("worker2", workerTask2, &workerId2, 5, 0, 2048);
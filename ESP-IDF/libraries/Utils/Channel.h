@@ -0,0 +1,261 @@
+#ifndef CHANNEL_H
+#define CHANNEL_H
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+/*
+Lock-free typed channels and shared-state cells for passing data between tasks.
+
+Everything here only uses std::atomic and has no FreeRTOS dependency, so the
+same header runs on the target and on a host build. None of the calls block:
+a consumer that wants to sleep pairs a channel with a task notification
+(xTaskNotifyGive after push, ulTaskNotifyTake before pop).
+
+- spscChannel: one producer task, one consumer task. Cheapest, and supports
+  zero-copy claim()/commit() and peek()/release().
+- mpmcChannel: any number of producers and consumers (bounded Vyukov queue).
+- seqCell: latest-value cell - one writer, any number of readers, readers
+  never block the writer and always get a consistent copy.
+- topicBus: publish once, every subscriber gets its own copy in its own queue.
+
+Capacities are compile-time powers of two so indices wrap with a mask.
+*/
+#ifndef UTILS_CACHE_LINE
+#ifdef ESP_PLATFORM
+#define UTILS_CACHE_LINE 32
+#else
+#define UTILS_CACHE_LINE 64
+#endif
+#endif
+
+namespace Utils{
+    //-----------------------------------------
+    //Single producer / single consumer ring
+    //-----------------------------------------
+    template<typename T, size_t N>
+    class spscChannel{
+        static_assert(N >= 2 && (N & (N - 1)) == 0, "spscChannel capacity must be a power of two");
+        private:
+            alignas(UTILS_CACHE_LINE) std::atomic<size_t> _head{0};// Next slot to read - written by the consumer
+            alignas(UTILS_CACHE_LINE) std::atomic<size_t> _tail{0};// Next slot to write - written by the producer
+            alignas(UTILS_CACHE_LINE) T _ring[N];
+        public:
+            spscChannel(){};
+            //Producer side
+            bool push(const T& item){
+                T* slot = claim();
+                if(slot == nullptr){return false;}
+                *slot = item;
+                commit();
+                return true;
+            }
+            //Zero-copy write: fill the returned slot in place, then commit(). nullptr when full
+            T* claim(){
+                size_t tail = _tail.load(std::memory_order_relaxed);
+                if(tail - _head.load(std::memory_order_acquire) >= N){return nullptr;}
+                return &_ring[tail & (N - 1)];
+            }
+            void commit(){_tail.store(_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);}
+            //Consumer side
+            bool pop(T& item){
+                const T* slot = peek();
+                if(slot == nullptr){return false;}
+                item = *slot;
+                release();
+                return true;
+            }
+            //Zero-copy read: use the returned slot in place, then release(). nullptr when empty
+            const T* peek(){
+                size_t head = _head.load(std::memory_order_relaxed);
+                if(head == _tail.load(std::memory_order_acquire)){return nullptr;}
+                return &_ring[head & (N - 1)];
+            }
+            void release(){_head.store(_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);}
+            size_t size() const {return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);}
+            bool empty() const {return size() == 0;}
+            static constexpr size_t capacity(){return N;}
+    };
+    //-----------------------------------------
+    //Multi producer / multi consumer ring
+    //-----------------------------------------
+    /*
+    Each cell carries a sequence number. A producer owns cell i when seq == i,
+    a consumer when seq == i + 1, so producers and consumers only contend on
+    their own position counter and never take a lock.
+    */
+    template<typename T, size_t N>
+    class mpmcChannel{
+        static_assert(N >= 2 && (N & (N - 1)) == 0, "mpmcChannel capacity must be a power of two");
+        private:
+            struct cell{
+                std::atomic<size_t> seq;
+                T data;
+            };
+            alignas(UTILS_CACHE_LINE) cell _cells[N];
+            alignas(UTILS_CACHE_LINE) std::atomic<size_t> _enqueue{0};
+            alignas(UTILS_CACHE_LINE) std::atomic<size_t> _dequeue{0};
+        public:
+            mpmcChannel(){
+                for(size_t i = 0; i < N; i++){_cells[i].seq.store(i, std::memory_order_relaxed);}
+            }
+            bool push(const T& item){
+                size_t pos = _enqueue.load(std::memory_order_relaxed);
+                cell* c;
+                while(true){
+                    c = &_cells[pos & (N - 1)];
+                    intptr_t diff = (intptr_t)c->seq.load(std::memory_order_acquire) - (intptr_t)pos;
+                    if(diff == 0){
+                        if(_enqueue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)){break;}
+                    } else if(diff < 0){
+                        return false;// Full
+                    } else {
+                        pos = _enqueue.load(std::memory_order_relaxed);
+                    }
+                }
+                c->data = item;
+                c->seq.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+            bool pop(T& item){
+                size_t pos = _dequeue.load(std::memory_order_relaxed);
+                cell* c;
+                while(true){
+                    c = &_cells[pos & (N - 1)];
+                    intptr_t diff = (intptr_t)c->seq.load(std::memory_order_acquire) - (intptr_t)(pos + 1);
+                    if(diff == 0){
+                        if(_dequeue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)){break;}
+                    } else if(diff < 0){
+                        return false;// Empty
+                    } else {
+                        pos = _dequeue.load(std::memory_order_relaxed);
+                    }
+                }
+                item = c->data;
+                c->seq.store(pos + N, std::memory_order_release);
+                return true;
+            }
+            //Approximate while producers/consumers are active
+            size_t size() const {
+                size_t enq = _enqueue.load(std::memory_order_relaxed);
+                size_t deq = _dequeue.load(std::memory_order_relaxed);
+                return (enq > deq) ? enq - deq : 0;
+            }
+            bool empty() const {return size() == 0;}
+            static constexpr size_t capacity(){return N;}
+    };
+    //-----------------------------------------
+    //Latest-value cell (seqlock)
+    //-----------------------------------------
+    /*
+    The writer makes the sequence odd, copies the value and makes it even
+    again. A reader copies the value and retries if the sequence was odd or
+    changed meanwhile. Readers never block the writer, so a sensor task can
+    publish snapshots at full rate while slower tasks read whenever they like.
+    Only one task may write.
+    */
+    template<typename T>
+    class seqCell{
+        static_assert(std::is_trivially_copyable<T>::value, "seqCell needs a trivially copyable type");
+        private:
+            static constexpr size_t WORDS = (sizeof(T) + 3) / 4;
+            std::atomic<uint32_t> _seq{0};
+            std::atomic<uint32_t> _words[WORDS];// Value copied word by word so a racing read is well defined
+        public:
+            seqCell(){
+                for(size_t i = 0; i < WORDS; i++){_words[i].store(0, std::memory_order_relaxed);}
+            }
+            void write(const T& value){
+                uint32_t buffer[WORDS] = {0};
+                memcpy(buffer, &value, sizeof(T));
+                uint32_t seq = _seq.load(std::memory_order_relaxed);
+                _seq.store(seq + 1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+                for(size_t i = 0; i < WORDS; i++){_words[i].store(buffer[i], std::memory_order_relaxed);}
+                _seq.store(seq + 2, std::memory_order_release);
+            }
+            T read() const {
+                T copy;
+                while(!tryRead(copy)){}
+                return copy;
+            }
+            //Single attempt - false if it raced with write()
+            bool tryRead(T& copy) const {
+                uint32_t before = _seq.load(std::memory_order_acquire);
+                if(before & 1){return false;}
+                uint32_t buffer[WORDS];
+                for(size_t i = 0; i < WORDS; i++){buffer[i] = _words[i].load(std::memory_order_relaxed);}
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if(_seq.load(std::memory_order_relaxed) != before){return false;}
+                memcpy(&copy, buffer, sizeof(T));
+                return true;
+            }
+            //Changes on every write - compare with a saved value to detect new data
+            uint32_t version() const {return _seq.load(std::memory_order_acquire) >> 1;}
+    };
+    //-----------------------------------------
+    //Publish / subscribe topic
+    //-----------------------------------------
+    /*
+    publish() copies the message into the queue of every subscriber, so a
+    slow subscriber only drops its own messages. The latest message is also
+    kept in a seqCell for subscribers that only care about the current value.
+    Subscribe before publishing starts; subscribe() itself is not lock-free.
+    */
+    template<typename T, size_t MAX_SUBS = 4, size_t DEPTH = 8>
+    class topicBus{
+        private:
+            mpmcChannel<T, DEPTH> _queues[MAX_SUBS];
+            std::atomic<bool> _active[MAX_SUBS];
+            std::atomic<uint32_t> _dropped[MAX_SUBS];
+            std::atomic<uint32_t> _published{0};
+            seqCell<T> _latest;
+        public:
+            topicBus(){
+                for(size_t i = 0; i < MAX_SUBS; i++){
+                    _active[i].store(false, std::memory_order_relaxed);
+                    _dropped[i].store(0, std::memory_order_relaxed);
+                }
+            }
+            //Returns the subscriber id, or -1 when all MAX_SUBS slots are taken
+            int subscribe(){
+                for(size_t i = 0; i < MAX_SUBS; i++){
+                    bool expected = false;
+                    if(_active[i].compare_exchange_strong(expected, true, std::memory_order_acq_rel)){return (int)i;}
+                }
+                return -1;
+            }
+            void unsubscribe(int id){
+                if(id < 0 || id >= (int)MAX_SUBS){return;}
+                _active[id].store(false, std::memory_order_release);
+                T drain;
+                while(_queues[id].pop(drain)){}
+            }
+            //Single publisher per topic when the latest value matters - returns how many subscribers got it
+            size_t publish(const T& message){
+                _latest.write(message);
+                _published.fetch_add(1, std::memory_order_relaxed);
+                size_t delivered = 0;
+                for(size_t i = 0; i < MAX_SUBS; i++){
+                    if(!_active[i].load(std::memory_order_acquire)){continue;}
+                    if(_queues[i].push(message)){
+                        delivered++;
+                    } else {
+                        _dropped[i].fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+                return delivered;
+            }
+            bool receive(int id, T& message){
+                if(id < 0 || id >= (int)MAX_SUBS){return false;}
+                return _queues[id].pop(message);
+            }
+            T latest() const {return _latest.read();}
+            uint32_t published() const {return _published.load(std::memory_order_relaxed);}
+            uint32_t dropped(int id) const {
+                return (id >= 0 && id < (int)MAX_SUBS) ? _dropped[id].load(std::memory_order_relaxed) : 0;
+            }
+    };
+}
+#endif // CHANNEL_H
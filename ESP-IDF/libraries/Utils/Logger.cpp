@@ -0,0 +1,272 @@
+#include <stdio.h>
+#include "Logger.h"
+#include "sdkconfig.h"
+
+namespace Utils {
+#ifdef CONFIG_LOG_DEFAULT_LEVEL
+#define UTILS_LOG_DEFAULT_LEVEL ((esp_log_level_t)CONFIG_LOG_DEFAULT_LEVEL)
+#else
+#define UTILS_LOG_DEFAULT_LEVEL ESP_LOG_INFO
+#endif
+
+mpmcChannel<deferredLog::record, UTILS_LOG_RECORDS> deferredLog::_ring;
+deferredLog::bucket deferredLog::_buckets[UTILS_LOG_TAGS];
+std::atomic<esp_log_level_t> deferredLog::_level{UTILS_LOG_DEFAULT_LEVEL};
+std::atomic<uint32_t> deferredLog::_written{0};
+std::atomic<uint32_t> deferredLog::_dropped{0};
+std::atomic<uint32_t> deferredLog::_limited{0};
+TaskHandle_t deferredLog::_task = nullptr;
+std::atomic<bool> deferredLog::_stop{false};
+
+static const char LEVEL_CHAR[] = {'N', 'E', 'W', 'I', 'D', 'V'};
+
+bool deferredLog::begin(UBaseType_t priority, BaseType_t core, uint32_t stackSize){
+    if(_task != nullptr){return true;}
+    _stop = false;
+    if(xTaskCreatePinnedToCore(formatLoop, "deferredLog", stackSize, NULL, priority, &_task, core) != pdPASS){
+        _task = nullptr;
+        ESP_LOGE("DLOG", "Failed to start formatter task");
+        return false;
+    }
+    return true;
+}
+
+void deferredLog::end(){
+    if(_task == nullptr){return;}
+    flush();
+    _stop = true;
+    xTaskNotifyGive(_task);
+    while(_task != nullptr){vTaskDelay(1);}
+}
+
+bool deferredLog::setRate(const char* tag, uint16_t perSecond, uint16_t burst){
+    if(tag == nullptr){return false;}
+    bucket* free = nullptr;
+    for(auto& b : _buckets){
+        const char* current = b.tag.load(std::memory_order_acquire);
+        if(current != nullptr && strcmp(current, tag) == 0){
+            if(perSecond == 0){
+                b.tag.store(nullptr, std::memory_order_release);// Unlimited again
+                return true;
+            }
+            b.rate = perSecond;
+            b.burst = (burst > 0) ? burst : perSecond;
+            return true;
+        }
+        if(current == nullptr && free == nullptr){free = &b;}
+    }
+    if(perSecond == 0){return true;}
+    if(free == nullptr){
+        ESP_LOGW("DLOG", "No free rate-limit slot for tag %s (UTILS_LOG_TAGS=%d)", tag, UTILS_LOG_TAGS);
+        return false;
+    }
+    free->rate = perSecond;
+    free->burst = (burst > 0) ? burst : perSecond;
+    free->carry = 0;
+    free->tokens.store(free->burst, std::memory_order_relaxed);
+    free->limited.store(0, std::memory_order_relaxed);
+    free->tag.store(tag, std::memory_order_release);// Publish last so callers see rate and tokens
+    return true;
+}
+
+//Hot path: pointer compare first, strcmp only for tags that are rate limited
+bool deferredLog::takeToken(const char* tag){
+    for(auto& b : _buckets){
+        const char* current = b.tag.load(std::memory_order_acquire);
+        if(current == nullptr || (current != tag && strcmp(current, tag) != 0)){continue;}
+        if(b.tokens.fetch_sub(1, std::memory_order_relaxed) > 0){return true;}
+        b.limited.fetch_add(1, std::memory_order_relaxed);
+        _limited.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+//Called by the formatter task only
+void deferredLog::refill(uint32_t elapsedMs){
+    for(auto& b : _buckets){
+        if(b.tag.load(std::memory_order_acquire) == nullptr){continue;}
+        // Keep the remainder, or a slow rate refilled every UTILS_LOG_FLUSH_MS would never earn a token
+        uint64_t earned = (uint64_t)b.rate * elapsedMs + b.carry;
+        int32_t add = (earned / 1000 > b.burst) ? b.burst : (int32_t)(earned / 1000);
+        b.carry = earned % 1000;
+        if(add == 0){continue;}
+        int32_t current = b.tokens.load(std::memory_order_relaxed);
+        int32_t next;
+        do{
+            next = ((current < 0) ? 0 : current) + add;// Denied calls took tokens below zero
+            if(next > b.burst){next = b.burst;}
+        }while(!b.tokens.compare_exchange_weak(current, next, std::memory_order_relaxed));
+    }
+}
+
+void deferredLog::submit(const record& rec){
+    if(_task == nullptr){// Not started: print now, on the caller
+        _written.fetch_add(1, std::memory_order_relaxed);
+        print(rec);
+        return;
+    }
+    if(!_ring.push(rec)){
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    _written.fetch_add(1, std::memory_order_relaxed);
+    // Wake the formatter early when the ring is half full - otherwise it polls every UTILS_LOG_FLUSH_MS
+    if(_ring.size() >= UTILS_LOG_RECORDS / 2 && !xPortInIsrContext()){xTaskNotifyGive(_task);}
+}
+
+bool deferredLog::flush(TickType_t timeout){
+    if(_task == nullptr){return true;}
+    TickType_t start = xTaskGetTickCount();
+    xTaskNotifyGive(_task);
+    while(!_ring.empty()){
+        if(xTaskGetTickCount() - start >= timeout){return false;}
+        vTaskDelay(1);
+    }
+    return true;
+}
+
+deferredLog::logStats deferredLog::stats(){
+    return {_written.load(std::memory_order_relaxed), _dropped.load(std::memory_order_relaxed),
+            _limited.load(std::memory_order_relaxed), (uint32_t)_ring.size()};
+}
+
+//Mini printf: walks the format and calls snprintf once per conversion with the packed argument
+size_t deferredLog::format(const record& rec, char* buf, size_t len){
+    if(buf == nullptr || len == 0){return 0;}
+    size_t pos = 0;
+    uint8_t arg = 0;
+    size_t offset = 0;
+    auto room = [&]() -> size_t {return (pos < len) ? len - pos : 0;};
+    auto advance = [&](int written){
+        if(written > 0){pos += written;}
+        if(pos >= len){pos = len - 1;}
+    };
+    const char* p = rec.fmt;
+    while(*p && pos < len - 1){
+        if(*p != '%'){
+            buf[pos++] = *p++;
+            continue;
+        }
+        if(p[1] == '%'){
+            buf[pos++] = '%';
+            p += 2;
+            continue;
+        }
+        // Copy flags, width and precision; drop length modifiers - arguments are stored widened
+        char spec[24];
+        size_t s = 0;
+        spec[s++] = *p++;
+        while(*p && strchr("-+ #0123456789.", *p) && s < sizeof(spec) - 4){spec[s++] = *p++;}
+        while(*p && strchr("hlzjtLq", *p)){p++;}
+        char conv = *p ? *p++ : '\0';
+        if(conv == '\0'){break;}
+        if(arg >= rec.argc){
+            advance(snprintf(buf + pos, room(), "?"));
+            continue;
+        }
+        char type = rec.types[arg++];
+        const uint8_t* data = rec.payload + offset;
+        if(type == 's'){
+            uint8_t strLen = data[0];
+            offset += 1 + strLen;
+            if(conv == 's'){
+                char str[UTILS_LOG_PAYLOAD];
+                memcpy(str, data + 1, strLen);
+                str[strLen] = '\0';
+                spec[s++] = 's';
+                spec[s] = '\0';
+                advance(snprintf(buf + pos, room(), spec, str));
+            } else {
+                advance(snprintf(buf + pos, room(), "?"));
+            }
+            continue;
+        }
+        if(type == 'p'){
+            uintptr_t v;
+            memcpy(&v, data, sizeof(v));
+            offset += sizeof(v);
+            advance(snprintf(buf + pos, room(), "%p", (void*)v));
+            continue;
+        }
+        offset += 8;
+        if(type == 'f'){
+            double v;
+            memcpy(&v, data, sizeof(v));
+            if(strchr("fFeEgGaA", conv)){
+                spec[s++] = conv;
+                spec[s] = '\0';
+                advance(snprintf(buf + pos, room(), spec, v));
+            } else {
+                advance(snprintf(buf + pos, room(), "%g", v));
+            }
+            continue;
+        }
+        uint64_t raw;
+        memcpy(&raw, data, sizeof(raw));
+        if(conv == 'c'){
+            spec[s++] = 'c';
+            spec[s] = '\0';
+            advance(snprintf(buf + pos, room(), spec, (int)raw));
+        } else if(conv == 'p'){
+            advance(snprintf(buf + pos, room(), "%p", (void*)(uintptr_t)raw));
+        } else if(strchr("fFeEgGaA", conv)){
+            spec[s++] = conv;
+            spec[s] = '\0';
+            advance(snprintf(buf + pos, room(), spec, (type == 'i') ? (double)(int64_t)raw : (double)raw));
+        } else if(strchr("diouxX", conv)){
+            spec[s++] = 'l';
+            spec[s++] = 'l';
+            spec[s++] = conv;
+            spec[s] = '\0';
+            advance(snprintf(buf + pos, room(), spec, raw));
+        } else {
+            advance(snprintf(buf + pos, room(), "?"));
+        }
+    }
+    if(rec.truncated && pos + 3 < len){
+        memcpy(buf + pos, "...", 3);
+        pos += 3;
+    }
+    buf[pos] = '\0';
+    return pos;
+}
+
+void deferredLog::print(const record& rec){
+    char line[256];
+    format(rec, line, sizeof(line));
+    esp_log_level_t level = (esp_log_level_t)rec.level;
+    char levelChar = (rec.level < sizeof(LEVEL_CHAR)) ? LEVEL_CHAR[rec.level] : '?';
+    esp_log_write(level, rec.tag, "%c (%lu) %s: %s\n", levelChar, (unsigned long)rec.timestamp, rec.tag, line);
+}
+
+void deferredLog::formatLoop(void* param){
+    TickType_t lastRefill = xTaskGetTickCount();
+    TickType_t lastReport = lastRefill;
+    uint32_t reportedDropped = 0, reportedLimited = 0;
+    record rec;
+    while(!_stop){
+        while(_ring.pop(rec)){print(rec);}
+        TickType_t now = xTaskGetTickCount();
+        refill(pdTICKS_TO_MS(now - lastRefill));
+        lastRefill = now;
+        // Report losses at most once per second, so the report itself cannot flood the UART
+        if(now - lastReport >= pdMS_TO_TICKS(1000)){
+            uint32_t dropped = _dropped.load(std::memory_order_relaxed);
+            uint32_t limited = _limited.load(std::memory_order_relaxed);
+            if(dropped != reportedDropped || limited != reportedLimited){
+                ESP_LOGW("DLOG", "%lu records dropped (ring full), %lu rate limited",
+                         (unsigned long)(dropped - reportedDropped), (unsigned long)(limited - reportedLimited));
+                reportedDropped = dropped;
+                reportedLimited = limited;
+            }
+            lastReport = now;
+        }
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(UTILS_LOG_FLUSH_MS));
+    }
+    while(_ring.pop(rec)){print(rec);}
+    _task = nullptr;
+    vTaskDelete(NULL);
+}
+
+} // namespace Utils
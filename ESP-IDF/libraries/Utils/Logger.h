@@ -0,0 +1,177 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <string>
+#include <type_traits>
+#include "Channel.h"
+/*
+Deferred binary logging.
+
+ESP_LOGI formats the message and writes it to the UART before returning, which
+costs milliseconds per line at 115200 baud. DLOGx macros only store the format
+pointer, the tag pointer, a timestamp and the raw arguments (strings are copied)
+in a lock-free ring; a low-priority task formats and prints them later.
+
+- Format strings must be literals and tags must outlive the record (string
+  literals or static strings) - only their pointers are stored.
+- Records that do not fit in the ring are dropped and counted, never blocked on.
+- setRate() limits a tag to a token bucket so one chatty module cannot flood
+  the ring.
+- Before begin() records are formatted synchronously on the caller.
+*/
+#ifndef UTILS_LOG_RECORDS
+#define UTILS_LOG_RECORDS 64// Ring capacity, power of two
+#endif
+#ifndef UTILS_LOG_PAYLOAD
+#define UTILS_LOG_PAYLOAD 48// Bytes of packed arguments per record
+#endif
+#ifndef UTILS_LOG_MAX_ARGS
+#define UTILS_LOG_MAX_ARGS 8
+#endif
+#ifndef UTILS_LOG_TAGS
+#define UTILS_LOG_TAGS 8// Tags that can have a rate limit
+#endif
+#ifndef UTILS_LOG_FLUSH_MS
+#define UTILS_LOG_FLUSH_MS 50// Formatter wake-up period when the ring is quiet
+#endif
+
+namespace Utils{
+    class deferredLog{
+        public:
+            struct record{
+                const char* fmt;
+                const char* tag;
+                uint32_t timestamp;// esp_log_timestamp() when the record was written
+                uint8_t level;
+                uint8_t argc;
+                uint8_t used;// Payload bytes in use
+                uint8_t truncated;// Arguments or string bytes that did not fit
+                char types[UTILS_LOG_MAX_ARGS];// 'i' int64, 'u' uint64, 'f' double, 's' string, 'p' pointer
+                uint8_t payload[UTILS_LOG_PAYLOAD];
+            };
+            struct logStats{
+                uint32_t written;// Records queued or printed
+                uint32_t dropped;// Ring full
+                uint32_t limited;// Rejected by a tag rate limit
+                uint32_t pending;// Records waiting for the formatter
+            };
+            static bool begin(UBaseType_t priority = 1, BaseType_t core = tskNO_AFFINITY, uint32_t stackSize = 3072);
+            static void end();
+            static bool running(){return _task != nullptr;}
+            //Least important level that is recorded - ESP_LOG_INFO drops debug and verbose records at the call site
+            static void setLevel(esp_log_level_t level){_level.store(level, std::memory_order_relaxed);}
+            static bool enabled(esp_log_level_t level){return level <= _level.load(std::memory_order_relaxed);}
+            //Token bucket per tag: perSecond records sustained, burst records at once. perSecond = 0 removes the limit
+            static bool setRate(const char* tag, uint16_t perSecond, uint16_t burst);
+            static bool flush(TickType_t timeout = pdMS_TO_TICKS(1000));
+            static logStats stats();
+            //Formats a record the way the formatter task does - returns the message length
+            static size_t format(const record& rec, char* buf, size_t len);
+
+            template<typename... Args>
+            static void write(esp_log_level_t level, const char* tag, const char* fmt, const Args&... args){
+                static_assert(sizeof...(Args) <= UTILS_LOG_MAX_ARGS, "Too many arguments for a deferred log record");
+                if(!enabled(level) || !takeToken(tag)){return;}
+                record rec;
+                rec.fmt = fmt;
+                rec.tag = tag;
+                rec.timestamp = esp_log_timestamp();
+                rec.level = level;
+                rec.argc = 0;
+                rec.used = 0;
+                rec.truncated = 0;
+                (pack(rec, args), ...);
+                submit(rec);
+            }
+        private:
+            struct bucket{
+                std::atomic<const char*> tag{nullptr};
+                uint16_t rate = 0;
+                uint16_t burst = 0;
+                std::atomic<int32_t> tokens{0};
+                uint16_t carry = 0;// Thousandths of a token left over by refill() - formatter task only
+                std::atomic<uint32_t> limited{0};
+            };
+            static mpmcChannel<record, UTILS_LOG_RECORDS> _ring;
+            static bucket _buckets[UTILS_LOG_TAGS];
+            static std::atomic<esp_log_level_t> _level;
+            static std::atomic<uint32_t> _written;
+            static std::atomic<uint32_t> _dropped;
+            static std::atomic<uint32_t> _limited;
+            static TaskHandle_t _task;
+            static std::atomic<bool> _stop;
+            static void formatLoop(void* param);
+            static void print(const record& rec);
+            static void refill(uint32_t elapsedMs);
+            static bool takeToken(const char* tag);
+            static void submit(const record& rec);
+
+            static void putBytes(record& rec, char type, const void* data, size_t size){
+                if(rec.argc >= UTILS_LOG_MAX_ARGS || rec.used + size > UTILS_LOG_PAYLOAD){
+                    rec.truncated = 1;
+                    return;
+                }
+                rec.types[rec.argc++] = type;
+                memcpy(rec.payload + rec.used, data, size);
+                rec.used += size;
+            }
+            //Strings are copied with a length byte so the caller's buffer can go away
+            static void putString(record& rec, const char* str){
+                if(str == nullptr){str = "(null)";}
+                if(rec.argc >= UTILS_LOG_MAX_ARGS || rec.used + 1 > UTILS_LOG_PAYLOAD){
+                    rec.truncated = 1;
+                    return;
+                }
+                size_t room = UTILS_LOG_PAYLOAD - rec.used - 1;
+                size_t len = strnlen(str, room + 1);
+                if(len > room){
+                    len = room;
+                    rec.truncated = 1;
+                }
+                rec.types[rec.argc++] = 's';
+                rec.payload[rec.used++] = (uint8_t)len;
+                memcpy(rec.payload + rec.used, str, len);
+                rec.used += len;
+            }
+            template<typename T>
+            static void pack(record& rec, const T& value){
+                using U = std::decay_t<T>;
+                if constexpr(std::is_same_v<U, char*> || std::is_same_v<U, const char*>){
+                    putString(rec, value);
+                } else if constexpr(std::is_same_v<U, std::string>){
+                    putString(rec, value.c_str());
+                } else if constexpr(std::is_floating_point_v<U>){
+                    double v = value;
+                    putBytes(rec, 'f', &v, sizeof(v));
+                } else if constexpr(std::is_enum_v<U>){
+                    int64_t v = (int64_t)value;
+                    putBytes(rec, 'i', &v, sizeof(v));
+                } else if constexpr(std::is_integral_v<U> && std::is_signed_v<U>){
+                    int64_t v = value;
+                    putBytes(rec, 'i', &v, sizeof(v));
+                } else if constexpr(std::is_integral_v<U>){
+                    uint64_t v = value;
+                    putBytes(rec, 'u', &v, sizeof(v));
+                } else if constexpr(std::is_pointer_v<U>){
+                    uintptr_t v = (uintptr_t)value;
+                    putBytes(rec, 'p', &v, sizeof(v));
+                } else {
+                    static_assert(std::is_pointer_v<U>, "Unsupported deferred log argument type");
+                }
+            }
+    };
+}
+
+//Drop-in replacements for ESP_LOGx on hot paths. fmt must be a string literal
+#define DLOGE(tag, fmt, ...) Utils::deferredLog::write(ESP_LOG_ERROR, tag, "" fmt, ##__VA_ARGS__)
+#define DLOGW(tag, fmt, ...) Utils::deferredLog::write(ESP_LOG_WARN, tag, "" fmt, ##__VA_ARGS__)
+#define DLOGI(tag, fmt, ...) Utils::deferredLog::write(ESP_LOG_INFO, tag, "" fmt, ##__VA_ARGS__)
+#define DLOGD(tag, fmt, ...) Utils::deferredLog::write(ESP_LOG_DEBUG, tag, "" fmt, ##__VA_ARGS__)
+#define DLOGV(tag, fmt, ...) Utils::deferredLog::write(ESP_LOG_VERBOSE, tag, "" fmt, ##__VA_ARGS__)
+
+#endif // LOGGER_H
@@ -1,10 +1,182 @@
 #include <typeinfo>
+#include <cstdio>
+#include <cstdlib>
 #include "Utils.h"
+#include "Logger.h"
+
+#if !UTILS_TLS_SLOT
+#pragma message("Utils: CONFIG_FREERTOS_THREAD_LOCAL_STORAGE_POINTERS < 2, cancellation tokens use a table of UTILS_TOKEN_SLOTS tasks")
+#endif
+#if !UTILS_NOTIFY_WAKE
+#pragma message("Utils: CONFIG_FREERTOS_TASK_NOTIFICATION_ARRAY_ENTRIES < 2, join()/wait()/shouldStop() poll every UTILS_POLL_MS")
+#endif
 
 namespace Utils {
+//Wake a task blocked in notifyWait(); a no-op when it polls instead
+static inline void notifyWake(TaskHandle_t task){
+#if UTILS_NOTIFY_WAKE
+    xTaskNotifyGiveIndexed(task, UTILS_NOTIFY_INDEX);
+#else
+    (void)task;
+#endif
+}
+//Block for at most wait ticks; may return early, so callers re-check their condition
+static inline void notifyWait(TickType_t wait){
+#if UTILS_NOTIFY_WAKE
+    ulTaskNotifyTakeIndexed(UTILS_NOTIFY_INDEX, pdTRUE, wait);
+#else
+    TickType_t poll = pdMS_TO_TICKS(UTILS_POLL_MS);
+    if(poll == 0){poll = 1;}
+    vTaskDelay((wait < poll) ? wait : poll);
+#endif
+}
+//Cancellation token of the calling task: a TLS slot, or a table keyed by task handle when every slot is taken
+#if !UTILS_TLS_SLOT
+static struct{
+    TaskHandle_t task;
+    void* control;
+} tokenTable[UTILS_TOKEN_SLOTS];
+static portMUX_TYPE tokenLock = portMUX_INITIALIZER_UNLOCKED;
+#endif
+static void tokenClear(TaskHandle_t task){
+#if !UTILS_TLS_SLOT
+    taskENTER_CRITICAL(&tokenLock);
+    for(auto& entry : tokenTable){
+        if(entry.task == task){entry = {nullptr, nullptr};}
+    }
+    taskEXIT_CRITICAL(&tokenLock);
+#else
+    (void)task;
+#endif
+}
+static void tokenSet(void* control){
+#if UTILS_TLS_SLOT
+    vTaskSetThreadLocalStoragePointer(NULL, UTILS_TLS_INDEX, control);
+#else
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    tokenClear(self);// A stale entry from a deleted task with the same TCB
+    if(control == nullptr){return;}
+    bool stored = false;
+    taskENTER_CRITICAL(&tokenLock);
+    for(auto& entry : tokenTable){
+        if(entry.task == nullptr){
+            entry = {self, control};
+            stored = true;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL(&tokenLock);
+    if(!stored){ESP_LOGW("TASK_MANAGER", "No free token slot (UTILS_TOKEN_SLOTS=%d), task cannot be cancelled", UTILS_TOKEN_SLOTS);}
+#endif
+}
+static void* tokenGet(){
+#if UTILS_TLS_SLOT
+    return pvTaskGetThreadLocalStoragePointer(NULL, UTILS_TLS_INDEX);
+#else
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    void* control = nullptr;
+    taskENTER_CRITICAL(&tokenLock);
+    for(const auto& entry : tokenTable){
+        if(entry.task == self){
+            control = entry.control;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL(&tokenLock);
+    return control;
+#endif
+}
+//-----------------------------------------
+//Stack Arena
 //-----------------------------------------
+bool stackArena::begin(size_t bytes, uint32_t caps){
+    if(_base != nullptr){
+        ESP_LOGW("STACK_ARENA", "Arena already allocated");
+        return false;
+    }
+    bytes = (bytes + ALIGN - 1) & ~(ALIGN - 1);
+    _base = (uint8_t*)heap_caps_malloc(bytes, caps);
+    if(_base == nullptr){
+        ESP_LOGE("STACK_ARENA", "Failed to allocate %u byte arena", (unsigned)bytes);
+        return false;
+    }
+    _size = bytes;
+    _caps = caps;
+    _blocks.clear();
+    _blocks.push_back({0, bytes, false});
+    return true;
+}
+
+void* stackArena::alloc(size_t bytes){
+    if(_base == nullptr || bytes == 0){return nullptr;}
+    bytes = (bytes + ALIGN - 1) & ~(ALIGN - 1);
+    for(size_t i = 0; i < _blocks.size(); i++){
+        if(_blocks[i].used || _blocks[i].size < bytes){continue;}
+        if(_blocks[i].size > bytes){// Split, remainder stays free
+            _blocks.insert(_blocks.begin() + i + 1, {_blocks[i].offset + bytes, _blocks[i].size - bytes, false});
+            _blocks[i].size = bytes;
+        }
+        _blocks[i].used = true;
+        return _base + _blocks[i].offset;
+    }
+    return nullptr;
+}
+
+void stackArena::release(void* ptr){
+    if(ptr == nullptr || _base == nullptr){return;}
+    size_t offset = (uint8_t*)ptr - _base;
+    for(size_t i = 0; i < _blocks.size(); i++){
+        if(_blocks[i].offset != offset || !_blocks[i].used){continue;}
+        _blocks[i].used = false;
+        if(i + 1 < _blocks.size() && !_blocks[i + 1].used){// Merge with next
+            _blocks[i].size += _blocks[i + 1].size;
+            _blocks.erase(_blocks.begin() + i + 1);
+        }
+        if(i > 0 && !_blocks[i - 1].used){// Merge with previous
+            _blocks[i - 1].size += _blocks[i].size;
+            _blocks.erase(_blocks.begin() + i);
+        }
+        return;
+    }
+    ESP_LOGE("STACK_ARENA", "Pointer %p is not an arena block", ptr);
+}
+
+stackArena::report stackArena::stats(){
+    report result = {_size, 0, 0, 0, 0, 0, 0};
+    for(const auto& b : _blocks){
+        if(b.used){
+            result.used += b.size;
+            result.usedBlocks++;
+        }else{
+            result.free += b.size;
+            result.freeBlocks++;
+            if(b.size > result.largestFree){result.largestFree = b.size;}
+        }
+    }
+    if(result.free > 0){
+        result.fragmentation = 100 - (uint8_t)((result.largestFree * 100) / result.free);
+    }
+    return result;
+}
 
+void stackArena::end(){
+    if(_base != nullptr){heap_caps_free(_base);}
+    _base = nullptr;
+    _size = 0;
+    _blocks.clear();
+}
+
+stackArena::~stackArena(){end();}
+
+//-----------------------------------------
+//Task Manager
 //-----------------------------------------
+taskManager::taskManager(){
+    _lock = xSemaphoreCreateRecursiveMutex();
+}
+void taskManager::lock(){xSemaphoreTakeRecursive(_lock, portMAX_DELAY);}
+void taskManager::unlock(){xSemaphoreGiveRecursive(_lock);}
+
 void taskManager::statusTask(BaseType_t gpTaskResult, const char* TAG, const char* taskName) {
    if(gpTaskResult != pdPASS) {
       ESP_LOGE(TAG, "Failed to create %s task!", taskName);
@@ -13,54 +185,808 @@ void taskManager::statusTask(BaseType_t gpTaskResult, const char* TAG, const cha
    }
 }
 
-void taskManager::add(const std::string& name, TaskFunction_t taskFunc, void* param, UBaseType_t priority, BaseType_t core, uint32_t stackSize){
+bool taskManager::add(const std::string& name, TaskFunction_t taskFunc, void* param, UBaseType_t priority, BaseType_t core, uint32_t stackSize){
     taskStruct newTask;
     newTask.name = name;
     newTask.param = param;
     newTask.priority = priority;
     newTask.core = core;
     newTask.stackSize = stackSize;
-    BaseType_t result = xTaskCreatePinnedToCore(taskFunc, name.c_str(), stackSize, param, priority, &newTask.handle, core);
+    if(core != UTILS_AUTO_CORE && core != tskNO_AFFINITY && (core < 0 || core >= portNUM_PROCESSORS)){
+        ESP_LOGE("TASK_MANAGER", "Invalid core %d for task %s", (int)core, name.c_str());
+        return false;
+    }
+    newTask.control = std::make_shared<taskControl>();
+    newTask.control->owner = this;
+    newTask.control->func = taskFunc;
+    newTask.control->param = param;
+    newTask.control->name = name;
+    BaseType_t result = pdFAIL;
+    lock();
+    reap();
+    if(inMap(name, _taskMap)){// Overwriting the entry would orphan the running task
+        unlock();
+        ESP_LOGE("TASK_MANAGER", "Task already exists: %s", name.c_str());
+        return false;
+    }
+    if(core == UTILS_AUTO_CORE){
+        core = pickCore();
+        newTask.core = core;
+        newTask.autoCore = true;
+    }
+    if(_arena.ready()){
+        int16_t slot = -1;
+        for(size_t i = 0; i < _tcbUsed.size(); i++){
+            if(!_tcbUsed[i]){slot = i; break;}
+        }
+        StackType_t* stack = (slot >= 0) ? (StackType_t*)_arena.alloc(stackSize) : nullptr;
+        if(stack != nullptr){
+            newTask.handle = xTaskCreateStaticPinnedToCore(taskEntry, name.c_str(), stackSize, newTask.control.get(), priority, stack, &_tcbs[slot], core);
+            if(newTask.handle != nullptr){
+                _tcbUsed[slot] = true;
+                newTask.stack = stack;
+                newTask.tcbSlot = slot;
+                result = pdPASS;
+            }else{
+                _arena.release(stack);
+            }
+        }else{
+            ESP_LOGW("TASK_MANAGER", "Stack arena full, creating %s on the heap", name.c_str());
+        }
+    }
+    if(newTask.stack == nullptr){
+        result = xTaskCreatePinnedToCore(taskEntry, name.c_str(), stackSize, newTask.control.get(), priority, &newTask.handle, core);
+    }
     statusTask(result, "TASK_MANAGER", name.c_str());
     if(result == pdPASS){
         _taskMap[name] = newTask;
     }
+    unlock();
+    return result == pdPASS;
 }
 
-void taskManager::del(const std::string& name){
-    if(inMap(name, _taskMap)){
-        esp_err_t wdt_err = esp_task_wdt_delete(_taskMap[name].handle);
-        if(wdt_err != ESP_OK && wdt_err != ESP_ERR_NOT_FOUND){
-            ESP_LOGW("TASK_MANAGER", "Failed to unsubscribe task %s from watchdog: %s", name.c_str(), esp_err_to_name(wdt_err));
+void taskManager::del(const std::string& name, TickType_t timeout){
+    lock();
+    if(!inMap(name, _taskMap)){
+        unlock();
+        ESP_LOGE("TASK_MANAGER", "Task not found: %s", name.c_str());
+        return;
+    }
+    taskStruct& task = _taskMap[name];
+    if(task.handle == xTaskGetCurrentTaskHandle()){
+        // Self-deletion never returns: release the lock first. The idle task still needs a static TCB, so its slot is not reused
+        forget(task);
+        if(task.stack != nullptr){
+            ESP_LOGW("TASK_MANAGER", "Static task %s deleted itself, its arena slot is not reused", name.c_str());
         }
-        vTaskDelete(_taskMap[name].handle);
         _taskMap.erase(name);
+        unlock();
         ESP_LOGI("TASK_MANAGER", "Deleted task: %s", name.c_str());
-    } else {
-        ESP_LOGE("TASK_MANAGER", "Task not found: %s", name.c_str());
+        vTaskDelete(NULL);
     }
+    unlock();
+    cancel(name);
+    if(join(name, timeout)){
+        // A returned static task is gone once it has suspended itself and been reaped
+        while(true){
+            lock();
+            reap();
+            bool present = inMap(name, _taskMap);
+            unlock();
+            if(!present){break;}
+            vTaskDelay(1);
+        }
+        ESP_LOGI("TASK_MANAGER", "Stopped task: %s", name.c_str());
+        return;
+    }
+    lock();
+    if(inMap(name, _taskMap)){
+        taskStruct& stuck = _taskMap[name];
+        forget(stuck);
+        vTaskDelete(stuck.handle);
+        releaseStatic(stuck);
+        _taskMap.erase(name);
+        ESP_LOGW("TASK_MANAGER", "Task %s did not stop within %lu ms, deleted", name.c_str(), (unsigned long)pdTICKS_TO_MS(timeout));
+    }
+    unlock();
 }
 
 void taskManager::resetWatchdog(const std::string& name){
-    if(inMap(name, _taskMap)){
-        esp_err_t wdt_err = esp_task_wdt_reset();
-        if(wdt_err != ESP_OK){
-            ESP_LOGW("TASK_MANAGER", "Failed to reset watchdog for task %s: %s", name.c_str(), esp_err_to_name(wdt_err));
+    for(uint16_t i = 0; i < UTILS_MAX_WATCH; i++){
+        if(_watch[i].used && _watch[i].name == name){
+            beat({i, _watch[i].gen});
+            return;
         }
-    } else {
+    }
+    lock();
+    bool known = inMap(name, _taskMap);
+    unlock();
+    if(!known){// Managed tasks without a heartbeat are not an error - nothing to feed
         ESP_LOGE("TASK_MANAGER", "Task not found: %s", name.c_str());
     }
 }
-taskManager::~taskManager(){
-    for(auto const& taskPair : _taskMap){
-        esp_err_t wdt_err = esp_task_wdt_delete(taskPair.second.handle);
-        if(wdt_err != ESP_OK && wdt_err != ESP_ERR_NOT_FOUND){
-            ESP_LOGW("TASK_MANAGER", "Failed to unsubscribe task %s from watchdog: %s", taskPair.first.c_str(), esp_err_to_name(wdt_err));
+//-----------------------------------------
+//Cancellation and Join
+//-----------------------------------------
+//Every managed task starts here so a plain return from the task function is safe
+void taskManager::taskEntry(void* param){
+    taskControl* control = (taskControl*)param;
+    tokenSet(control);
+    control->func(control->param);
+    tokenSet(nullptr);
+    control->owner->taskReturned(control);
+}
+
+void taskManager::taskReturned(taskControl* control){
+    std::string name = control->name;
+    lock();// add() holds the lock until the task is in _taskMap
+    auto it = _taskMap.find(name);
+    bool isStatic = false;
+    if(it != _taskMap.end() && it->second.control.get() == control){
+        control->finished = true;
+        forget(it->second);
+        isStatic = it->second.stack != nullptr;
+        if(!isStatic){_taskMap.erase(it);}// Frees control - do not touch it below
+    }
+    unlock();
+    DLOGI("TASK_MANAGER", "Task returned: %s", name.c_str());
+    if(isStatic){
+        vTaskSuspend(NULL);// The stack is still in use - another task deletes us in reap()
+    }
+    vTaskDelete(NULL);
+}
+
+//Wake the joiner and unsubscribe from heartbeats and the hardware WDT. Caller holds _lock
+void taskManager::forget(const taskStruct& task){
+    tokenClear(task.handle);// Table mode: the handle may be reused by a task that is not managed
+    if(task.control && task.control->joiner != nullptr){
+        notifyWake(task.control->joiner);
+        task.control->joiner = nullptr;
+    }
+    for(uint16_t i = 0; i < UTILS_MAX_WATCH; i++){
+        if(_watch[i].used && _watch[i].name == task.name){unwatch({i, _watch[i].gen});}
+    }
+    esp_err_t wdt_err = esp_task_wdt_delete(task.handle);
+    if(wdt_err != ESP_OK && wdt_err != ESP_ERR_NOT_FOUND){
+        ESP_LOGW("TASK_MANAGER", "Failed to unsubscribe task %s from watchdog: %s", task.name.c_str(), esp_err_to_name(wdt_err));
+    }
+}
+
+//Delete returned static tasks once they have suspended and free their arena stacks. Caller holds _lock
+void taskManager::reap(){
+    for(auto it = _taskMap.begin(); it != _taskMap.end();){
+        taskStruct& task = it->second;
+        if(task.control && task.control->finished && eTaskGetState(task.handle) == eSuspended){
+            vTaskDelete(task.handle);
+            releaseStatic(task);
+            it = _taskMap.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool taskManager::cancel(const std::string& name){
+    lock();
+    auto it = _taskMap.find(name);
+    if(it == _taskMap.end()){
+        unlock();
+        return false;
+    }
+    it->second.control->cancel = true;
+    if(!it->second.control->finished){notifyWake(it->second.handle);}// Wakes shouldStop()
+    unlock();
+    return true;
+}
+
+//One joiner per task. Returns true once the task function has returned (or the task is not managed)
+bool taskManager::join(const std::string& name, TickType_t timeout){
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    TickType_t start = xTaskGetTickCount();
+    while(true){
+        lock();
+        auto it = _taskMap.find(name);
+        if(it == _taskMap.end() || it->second.control->finished){
+            unlock();
+            return true;
+        }
+        if(it->second.handle == self){
+            unlock();
+            ESP_LOGE("TASK_MANAGER", "Task %s cannot join itself", name.c_str());
+            return false;
+        }
+        it->second.control->joiner = self;
+        unlock();
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if(timeout != portMAX_DELAY && elapsed >= timeout){
+            lock();
+            it = _taskMap.find(name);
+            bool finished = it == _taskMap.end() || it->second.control->finished;
+            if(!finished && it->second.control->joiner == self){it->second.control->joiner = nullptr;}
+            unlock();
+            return finished;
+        }
+        notifyWait((timeout == portMAX_DELAY) ? portMAX_DELAY : timeout - elapsed);
+    }
+}
+
+bool taskManager::cancelled(){
+    taskControl* control = (taskControl*)tokenGet();
+    return control != nullptr && control->cancel.load();
+}
+
+//Use as the task's delay: returns early when cancel() is called
+bool taskManager::shouldStop(TickType_t wait){
+    TickType_t start = xTaskGetTickCount();
+    while(!cancelled()){
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if(elapsed >= wait){return false;}
+        notifyWait((wait == portMAX_DELAY) ? portMAX_DELAY : wait - elapsed);
+    }
+    return true;
+}
+
+//-----------------------------------------
+//Heartbeats
+//-----------------------------------------
+taskManager::watchHandle taskManager::watch(const std::string& name, uint32_t periodMs, bool critical){
+    watchHandle handle;
+    if(periodMs == 0){
+        ESP_LOGE("TASK_MANAGER", "Heartbeat period must be > 0: %s", name.c_str());
+        return handle;
+    }
+    for(uint16_t i = 0; i < UTILS_MAX_WATCH; i++){
+        if(!_watch[i].used){handle.slot = i; break;}
+    }
+    if(!handle.valid()){
+        ESP_LOGE("TASK_MANAGER", "No free heartbeat slot for %s (UTILS_MAX_WATCH=%d)", name.c_str(), UTILS_MAX_WATCH);
+        return handle;
+    }
+    watchSlot& slot = _watch[handle.slot];
+    slot.name = name;
+    slot.period = pdMS_TO_TICKS(periodMs);
+    slot.critical = critical;
+    slot.late = false;
+    slot.misses = 0;
+    slot.last.store(xTaskGetTickCount(), std::memory_order_relaxed);// Grace period starts now
+    portENTER_CRITICAL(&_watchLock);
+    slot.used = true;
+    handle.gen = slot.gen;
+    portEXIT_CRITICAL(&_watchLock);
+    startMonitor(_monitorPeriodMs);// No-op when already running
+    return handle;
+}
+
+void taskManager::beat(watchHandle handle){
+    if(handle.slot >= UTILS_MAX_WATCH || _watch[handle.slot].gen != handle.gen){return;}
+    _watch[handle.slot].last.store(xTaskGetTickCount(), std::memory_order_relaxed);
+}
+
+void taskManager::unwatch(watchHandle handle){
+    if(handle.slot >= UTILS_MAX_WATCH){return;}
+    portENTER_CRITICAL(&_watchLock);
+    if(_watch[handle.slot].used && _watch[handle.slot].gen == handle.gen){
+        _watch[handle.slot].used = false;
+        _watch[handle.slot].gen++;// Stale handles stop feeding the slot
+    }
+    portEXIT_CRITICAL(&_watchLock);
+}
+
+uint32_t taskManager::misses(watchHandle handle){
+    if(handle.slot >= UTILS_MAX_WATCH || _watch[handle.slot].gen != handle.gen){return 0;}
+    return _watch[handle.slot].misses;
+}
+
+bool taskManager::healthy(){
+    TickType_t now = xTaskGetTickCount();
+    for(auto& slot : _watch){
+        if(slot.used && slot.critical && (TickType_t)(now - slot.last.load(std::memory_order_relaxed)) > slot.period){return false;}
+    }
+    return true;
+}
+
+//Called by the monitor every UTILS_MONITOR_TICK_MS. Returns false while any critical heartbeat is late
+bool taskManager::checkWatch(){
+    bool ok = true;
+    TickType_t now = xTaskGetTickCount();
+    for(auto& slot : _watch){
+        if(!slot.used){continue;}
+        TickType_t age = now - slot.last.load(std::memory_order_relaxed);// Unsigned math survives tick wrap
+        if(age <= slot.period){
+            if(slot.late){DLOGI("TASK_MANAGER", "Heartbeat recovered: %s", slot.name.c_str());}
+            slot.late = false;
+            continue;
+        }
+        if(!slot.late){
+            slot.late = true;
+            slot.misses++;
+            if(slot.critical){
+                ESP_LOGE("TASK_MANAGER", "Critical task %s missed its deadline (%lu ms late), watchdog no longer fed", slot.name.c_str(), (unsigned long)pdTICKS_TO_MS(age - slot.period));
+            } else {
+                DLOGW("TASK_MANAGER", "Task %s missed its deadline (%lu ms late)", slot.name.c_str(), (unsigned long)pdTICKS_TO_MS(age - slot.period));
+            }
         }
-        vTaskDelete(taskPair.second.handle);
-        ESP_LOGI("TASK_MANAGER", "Deleted task: %s", taskPair.first.c_str());
+        if(slot.critical){ok = false;}
+    }
+    return ok;
+}
+//-----------------------------------------
+//Static Allocation
+//-----------------------------------------
+//Tasks added after this call get their stack from the arena and a reusable static TCB slot
+bool taskManager::useArena(size_t bytes, uint32_t caps, uint8_t maxTasks){
+    if(_arena.ready()){
+        ESP_LOGW("TASK_MANAGER", "Stack arena already configured");
+        return false;
+    }
+    _tcbs = (StaticTask_t*)heap_caps_malloc(sizeof(StaticTask_t) * maxTasks, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if(_tcbs == nullptr || !_arena.begin(bytes, caps)){
+        ESP_LOGE("TASK_MANAGER", "Failed to allocate stack arena");
+        if(_tcbs != nullptr){heap_caps_free(_tcbs);}
+        _tcbs = nullptr;
+        return false;
+    }
+    _tcbUsed.assign(maxTasks, false);
+    return true;
+}
+
+//A static task's memory can be reused as soon as another task has deleted it
+void taskManager::releaseStatic(taskStruct& task){
+    if(task.stack == nullptr){return;}
+    _arena.release(task.stack);
+    _tcbUsed[task.tcbSlot] = false;
+    task.stack = nullptr;
+    task.tcbSlot = -1;
+}
+
+stackArena::report taskManager::arenaReport(){return _arena.stats();}
+
+//-----------------------------------------
+//Profiler
+//-----------------------------------------
+void taskManager::startMonitor(uint32_t periodMs, UBaseType_t priority, BaseType_t core){
+    _monitorPeriodMs = (periodMs > 0) ? periodMs : 1000;
+    if(inMap("taskMonitor", _taskMap)){return;}
+    add("taskMonitor", monitorLoop, this, priority, core, 3072);
+}
+
+//The monitor is the only task subscribed to the hardware WDT - it feeds it while every critical heartbeat is on time
+void taskManager::monitorLoop(void* param){
+    taskManager* manager = (taskManager*)param;
+    esp_err_t wdt_err = esp_task_wdt_add(NULL);
+    if(wdt_err != ESP_OK){
+        ESP_LOGW("TASK_MANAGER", "Monitor could not subscribe to watchdog: %s", esp_err_to_name(wdt_err));
+    }
+    TickType_t lastSample = xTaskGetTickCount();
+    manager->sample();
+    while(!shouldStop(pdMS_TO_TICKS(UTILS_MONITOR_TICK_MS))){
+        if(manager->checkWatch() && wdt_err == ESP_OK){
+            esp_task_wdt_reset();
+        }
+        if(xTaskGetTickCount() - lastSample >= pdMS_TO_TICKS(manager->_monitorPeriodMs)){
+            lastSample = xTaskGetTickCount();
+            manager->sample();
+        }
+    }
+}
+
+//-----------------------------------------
+//Core Placement
+//-----------------------------------------
+void taskManager::setPlacement(placement policy){
+    _placement = policy;
+}
+
+//Core for a UTILS_AUTO_CORE task. Caller holds _lock
+BaseType_t taskManager::pickCore(){
+    if(_placement == placement::CORE0 || portNUM_PROCESSORS == 1){return 0;}
+    if(_placement == placement::FLOATING){return tskNO_AFFINITY;}
+    // Measured load, plus an estimate for tasks the monitor has not sampled yet (all of them without run-time stats)
+    uint32_t score[portNUM_PROCESSORS];
+    for(BaseType_t core = 0; core < portNUM_PROCESSORS; core++){score[core] = _coreLoadPermille[core];}
+    for(const auto& [name, task] : _taskMap){
+        if(task.core >= 0 && task.core < portNUM_PROCESSORS && !task.sampled){score[task.core] += UTILS_PLACE_ESTIMATE;}
+    }
+    // Ties go to the highest core - core 0 also runs the Wi-Fi/BT stacks
+    BaseType_t best = portNUM_PROCESSORS - 1;
+    for(BaseType_t core = portNUM_PROCESSORS - 2; core >= 0; core--){
+        if(score[core] < score[best]){best = core;}
+    }
+    return best;
+}
+
+bool taskManager::migrate(const std::string& name, BaseType_t core){
+    if(core < 0 || core >= portNUM_PROCESSORS){return false;}
+    lock();
+    auto it = _taskMap.find(name);
+    if(it == _taskMap.end()){
+        unlock();
+        ESP_LOGE("TASK_MANAGER", "Task not found: %s", name.c_str());
+        return false;
+    }
+#if defined(CONFIG_FREERTOS_SMP) && (configUSE_CORE_AFFINITY == 1)
+    vTaskCoreAffinitySet(it->second.handle, (UBaseType_t)1 << core);
+    it->second.core = core;
+    it->second.sampled = false;// Its load now counts on the new core until the next sample
+    unlock();
+    ESP_LOGI("TASK_MANAGER", "Moved task %s to core %d", name.c_str(), (int)core);
+    return true;
+#else
+    unlock();
+    ESP_LOGW("TASK_MANAGER", "Cannot move %s: affinity is fixed at creation on this FreeRTOS, use placement::FLOATING", name.c_str());
+    return false;
+#endif
+}
+
+//Move one auto-placed task from the busiest to the idlest core when the gap is large. Caller holds _lock
+void taskManager::rebalance(){
+#if defined(CONFIG_FREERTOS_SMP) && (configUSE_CORE_AFFINITY == 1)
+    if(_placement != placement::LEAST_LOADED || portNUM_PROCESSORS < 2){return;}
+    BaseType_t hot = 0, cold = 0;
+    for(BaseType_t core = 1; core < portNUM_PROCESSORS; core++){
+        if(_coreLoadPermille[core] > _coreLoadPermille[hot]){hot = core;}
+        if(_coreLoadPermille[core] < _coreLoadPermille[cold]){cold = core;}
+    }
+    uint16_t gap = _coreLoadPermille[hot] - _coreLoadPermille[cold];
+    if(gap < UTILS_REBALANCE_PERMILLE){return;}
+    // The task closest to half the gap evens the cores out without overshooting
+    taskStruct* best = nullptr;
+    for(auto& [name, task] : _taskMap){
+        if(!task.autoCore || task.core != hot || task.cpuPermille == 0 || task.cpuPermille >= gap){continue;}
+        if(best == nullptr || abs((int)task.cpuPermille - gap / 2) < abs((int)best->cpuPermille - gap / 2)){best = &task;}
+    }
+    if(best == nullptr){return;}
+    vTaskCoreAffinitySet(best->handle, (UBaseType_t)1 << cold);
+    DLOGI("TASK_MANAGER", "Rebalanced %s from core %d (%u) to core %d (%u)", best->name.c_str(),
+            (int)hot, (unsigned)_coreLoadPermille[hot], (int)cold, (unsigned)_coreLoadPermille[cold]);
+    best->core = cold;
+#endif
+}
+
+//Take one sample now - called by the monitor task, or manually when no monitor is running
+void taskManager::sample(){
+    lock();
+    reap();
+    for(auto& [name, task] : _taskMap){
+        task.minFreeStack = uxTaskGetStackHighWaterMark(task.handle);// Bytes on ESP-IDF (StackType_t is uint8_t)
+    }
+#if (configUSE_TRACE_FACILITY == 1) && (configGENERATE_RUN_TIME_STATS == 1)
+    UBaseType_t count = uxTaskGetNumberOfTasks() + 4;
+    std::vector<TaskStatus_t> status(count);
+    uint32_t totalRunTime = 0;
+    count = uxTaskGetSystemState(status.data(), count, &totalRunTime);
+    uint32_t window = totalRunTime - _lastTotalRunTime;// Unsigned math survives counter wrap
+    _lastTotalRunTime = totalRunTime;
+    for(UBaseType_t i = 0; i < count && window > 0; i++){
+        for(auto& [name, task] : _taskMap){
+            if(task.handle != status[i].xHandle){continue;}
+            uint32_t delta = status[i].ulRunTimeCounter - task.lastRunTime;
+            task.lastRunTime = status[i].ulRunTimeCounter;
+            task.cpuPermille = (uint16_t)(((uint64_t)delta * 1000) / window);
+            task.sampled = true;// Its load is now part of _coreLoadPermille
+        }
+        for(BaseType_t core = 0; core < portNUM_PROCESSORS; core++){
+            if(status[i].xHandle != xTaskGetIdleTaskHandleForCore(core)){continue;}
+            uint32_t idle = status[i].ulRunTimeCounter - _lastIdleRunTime[core];
+            _lastIdleRunTime[core] = status[i].ulRunTimeCounter;
+            uint32_t idlePermille = (uint32_t)(((uint64_t)idle * 1000) / window);
+            _coreLoadPermille[core] = (idlePermille >= 1000) ? 0 : 1000 - idlePermille;
+        }
+    }
+    rebalance();
+#endif
+    unlock();
+}
+
+//Peak usage plus 25% (at least 512 bytes), rounded up to 256 bytes
+uint32_t taskManager::recommendStack(uint32_t stackSize, uint32_t minFreeStack){
+    uint32_t used = (stackSize > minFreeStack) ? stackSize - minFreeStack : 0;
+    uint32_t margin = (used / 4 > 512) ? used / 4 : 512;
+    return ((used + margin + 255) / 256) * 256;
+}
+
+std::vector<taskManager::taskReport> taskManager::snapshot(){
+    std::vector<taskReport> result;
+    lock();
+    result.reserve(_taskMap.size());
+    for(const auto& [name, task] : _taskMap){
+        result.push_back({name, task.core, task.priority, task.stackSize, task.minFreeStack,
+                          recommendStack(task.stackSize, task.minFreeStack), task.cpuPermille, task.autoCore});
+    }
+    unlock();
+    return result;
+}
+
+uint16_t taskManager::coreLoad(BaseType_t core){
+    return (core >= 0 && core < portNUM_PROCESSORS) ? _coreLoadPermille[core] : 0;
+}
+
+//Compact JSON for the web server or serial: {"tasks":[{"n":..,"c":..,"p":..,"s":..,"f":..,"r":..,"cpu":..}],"cores":[..]}
+//cpu/cores are permille. Returns the length written (output is truncated to len-1 characters)
+size_t taskManager::snapshotJson(char* buf, size_t len){
+    if(buf == nullptr || len == 0){return 0;}
+    size_t pos = 0;
+    auto put = [&](int written){
+        if(written > 0){pos += written;}
+        if(pos >= len){pos = len - 1;}
+    };
+    put(snprintf(buf, len, "{\"tasks\":["));
+    bool first = true;
+    for(const auto& task : snapshot()){
+        put(snprintf(buf + pos, len - pos, "%s{\"n\":\"", first ? "" : ","));
+        for(unsigned char c : task.name){// Task names are user strings: escape ", \ and control characters
+            if(c == '"' || c == '\\'){
+                put(snprintf(buf + pos, len - pos, "\\%c", c));
+            }else if(c < 0x20){
+                put(snprintf(buf + pos, len - pos, "\\u%04x", c));
+            }else{
+                put(snprintf(buf + pos, len - pos, "%c", c));
+            }
+        }
+        put(snprintf(buf + pos, len - pos, "\",\"c\":%d,\"p\":%u,\"s\":%lu,\"f\":%lu,\"r\":%lu,\"cpu\":%u}",
+                     (int)task.core, (unsigned)task.priority,
+                     (unsigned long)task.stackSize, (unsigned long)task.minFreeStack,
+                     (unsigned long)task.recommendedStack, (unsigned)task.cpuPermille));
+        first = false;
+    }
+    put(snprintf(buf + pos, len - pos, "],\"cores\":["));
+    for(BaseType_t core = 0; core < portNUM_PROCESSORS; core++){
+        put(snprintf(buf + pos, len - pos, "%s%u", core ? "," : "", (unsigned)_coreLoadPermille[core]));
+    }
+    put(snprintf(buf + pos, len - pos, "]}"));
+    return pos;
+}
+
+//-----------------------------------------
+//Worker Pool
+//-----------------------------------------
+bool taskManager::startPool(uint8_t workersPerCore, UBaseType_t priority, uint32_t stackSize, uint16_t maxJobs){
+    if(_workers != nullptr){
+        ESP_LOGW("TASK_MANAGER", "Worker pool already running");
+        return false;
+    }
+    if(workersPerCore == 0 || maxJobs == 0 || maxJobs == 0xFFFF){
+        ESP_LOGE("TASK_MANAGER", "Invalid worker pool size");
+        return false;
+    }
+    _jobs.assign(maxJobs, jobSlot());
+    _freeJobs.clear();
+    _freeJobs.reserve(maxJobs);
+    for(uint16_t i = maxJobs; i > 0; i--){_freeJobs.push_back(i - 1);}
+    _workerCount = workersPerCore * portNUM_PROCESSORS;
+    _workers = new poolWorker[_workerCount];
+    _poolStopping = false;
+    for(uint8_t i = 0; i < _workerCount; i++){
+        poolWorker& worker = _workers[i];
+        worker.owner = this;
+        worker.index = i;
+        worker.core = i % portNUM_PROCESSORS;
+        worker.ring.assign(maxJobs, 0);// A job sits in at most one deque, so a deque never overflows
+        worker.name = "pool" + std::to_string(i);
+        if(add(worker.name, poolLoop, &worker, priority, worker.core, stackSize)){
+            lock();
+            if(inMap(worker.name, _taskMap)){worker.handle = _taskMap[worker.name].handle;}
+            unlock();
+        }
+        if(worker.handle == nullptr){
+            stopPool();
+            return false;
+        }
+    }
+    _poolRunning = true;
+    return true;
+}
+
+void taskManager::poolLoop(void* param){
+    poolWorker* worker = (poolWorker*)param;
+    taskManager* manager = worker->owner;
+    while(!manager->_poolStopping){
+        uint16_t slot;
+        if(manager->popJob(*worker, slot) || manager->stealJob(*worker, slot)){
+            jobSlot& job = manager->_jobs[slot];
+            job.func(job.param);
+            worker->executed++;
+            manager->finishJob(slot);
+            continue;
+        }
+        worker->idle = true;
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        worker->idle = false;
+    }
+}
+
+bool taskManager::pushJob(poolWorker& worker, uint16_t slot){
+    bool pushed = false;
+    taskENTER_CRITICAL(&worker.lock);
+    if(worker.count < worker.ring.size()){
+        worker.ring[(worker.head + worker.count) % worker.ring.size()] = slot;
+        worker.count++;
+        pushed = true;
+    }
+    taskEXIT_CRITICAL(&worker.lock);
+    return pushed;
+}
+
+bool taskManager::popJob(poolWorker& worker, uint16_t& slot){
+    bool popped = false;
+    taskENTER_CRITICAL(&worker.lock);
+    if(worker.count > 0){
+        slot = worker.ring[worker.head];
+        worker.head = (worker.head + 1) % worker.ring.size();
+        worker.count--;
+        popped = true;
+    }
+    taskEXIT_CRITICAL(&worker.lock);
+    return popped;
+}
+
+//Take the newest job from another worker - same core first, then the other core
+bool taskManager::stealJob(poolWorker& worker, uint16_t& slot){
+    for(uint8_t pass = 0; pass < 2; pass++){
+        for(uint8_t i = 1; i < _workerCount; i++){
+            poolWorker& victim = _workers[(worker.index + i) % _workerCount];
+            if((victim.core == worker.core) != (pass == 0)){continue;}
+            bool stolen = false;
+            taskENTER_CRITICAL(&victim.lock);
+            if(victim.count > 0){
+                victim.count--;
+                slot = victim.ring[(victim.head + victim.count) % victim.ring.size()];
+                stolen = true;
+            }
+            taskEXIT_CRITICAL(&victim.lock);
+            if(stolen){
+                worker.steals++;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void taskManager::finishJob(uint16_t slot){
+    taskENTER_CRITICAL(&_jobLock);
+    jobSlot& job = _jobs[slot];
+    TaskHandle_t waiter = job.waiter;
+    job.gen++;
+    job.func = nullptr;
+    job.param = NULL;
+    job.waiter = nullptr;
+    _freeJobs.push_back(slot);
+    taskEXIT_CRITICAL(&_jobLock);
+    if(waiter != nullptr){
+        notifyWake(waiter);
+    }
+}
+
+//Queue a job on the pool. The job must return (unlike a task function). core is a preference: idle workers may steal it
+taskManager::jobHandle taskManager::submit(TaskFunction_t job, void* param, BaseType_t core){
+    jobHandle handle;
+    if(!_poolRunning || job == nullptr){
+        _rejected++;
+        return handle;
+    }
+    taskENTER_CRITICAL(&_jobLock);
+    if(_freeJobs.empty()){
+        taskEXIT_CRITICAL(&_jobLock);
+        _rejected++;
+        return handle;
+    }
+    handle.slot = _freeJobs.back();
+    _freeJobs.pop_back();
+    _jobs[handle.slot].func = job;
+    _jobs[handle.slot].param = param;
+    _jobs[handle.slot].waiter = nullptr;
+    handle.gen = _jobs[handle.slot].gen;
+    taskEXIT_CRITICAL(&_jobLock);
+
+    uint32_t turn = _nextWorker++;
+    poolWorker* target;
+    if(core >= 0 && core < portNUM_PROCESSORS){
+        uint8_t perCore = _workerCount / portNUM_PROCESSORS;
+        target = &_workers[(turn % perCore) * portNUM_PROCESSORS + core];
+    }else{
+        target = &_workers[turn % _workerCount];
+    }
+    pushJob(*target, handle.slot);
+    _submitted++;
+    xTaskNotifyGive(target->handle);
+    if(!target->idle){// Target is busy - wake an idle worker so it can steal the job
+        for(uint8_t i = 0; i < _workerCount; i++){
+            if(_workers[i].idle){
+                xTaskNotifyGive(_workers[i].handle);
+                break;
+            }
+        }
+    }
+    return handle;
+}
+
+bool taskManager::done(jobHandle job){
+    if(!job.valid()){return true;}
+    taskENTER_CRITICAL(&_jobLock);
+    bool finished = job.slot >= _jobs.size() || _jobs[job.slot].gen != job.gen;
+    taskEXIT_CRITICAL(&_jobLock);
+    return finished;
+}
+
+//Block until the job finished or timeout expired. One waiter per job
+bool taskManager::wait(jobHandle job, TickType_t timeout){
+    if(!job.valid()){return true;}
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    TickType_t start = xTaskGetTickCount();
+    while(true){
+        taskENTER_CRITICAL(&_jobLock);
+        bool finished = job.slot >= _jobs.size() || _jobs[job.slot].gen != job.gen;
+        if(!finished){_jobs[job.slot].waiter = self;}
+        taskEXIT_CRITICAL(&_jobLock);
+        if(finished){return true;}
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if(timeout != portMAX_DELAY && elapsed >= timeout){
+            taskENTER_CRITICAL(&_jobLock);
+            if(_jobs[job.slot].gen == job.gen && _jobs[job.slot].waiter == self){_jobs[job.slot].waiter = nullptr;}
+            taskEXIT_CRITICAL(&_jobLock);
+            return false;
+        }
+        notifyWait((timeout == portMAX_DELAY) ? portMAX_DELAY : timeout - elapsed);
+    }
+}
+
+taskManager::poolStats taskManager::stats(){
+    poolStats result;
+    result.submitted = _submitted;
+    result.rejected = _rejected;
+    taskENTER_CRITICAL(&_jobLock);
+    result.pending = _jobs.size() - _freeJobs.size();
+    taskEXIT_CRITICAL(&_jobLock);
+    for(uint8_t i = 0; i < _workerCount; i++){
+        poolWorker& worker = _workers[i];
+        taskENTER_CRITICAL(&worker.lock);
+        uint16_t depth = worker.count;
+        taskEXIT_CRITICAL(&worker.lock);
+        result.workers.push_back({worker.core, depth, worker.executed.load(), worker.steals.load()});
+    }
+    return result;
+}
+
+//Stop the workers after their current job; queued jobs are dropped (their waiters are released)
+void taskManager::stopPool(){
+    if(_workers == nullptr){return;}
+    _poolRunning = false;
+    _poolStopping = true;
+    for(uint8_t i = 0; i < _workerCount; i++){
+        if(_workers[i].handle != nullptr){xTaskNotifyGive(_workers[i].handle);}
+    }
+    for(uint8_t i = 0; i < _workerCount; i++){
+        if(_workers[i].handle == nullptr){continue;}
+        join(_workers[i].name);
+    }
+    for(uint16_t slot = 0; slot < _jobs.size(); slot++){
+        if(_jobs[slot].func != nullptr){finishJob(slot);}
+    }
+    delete[] _workers;
+    _workers = nullptr;
+    _workerCount = 0;
+}
+
+taskManager::~taskManager(){
+    stopPool();
+    std::vector<std::string> names;
+    lock();
+    for(auto const& taskPair : _taskMap){names.push_back(taskPair.first);}
+    unlock();
+    for(const auto& name : names){cancel(name);}// Let every task wind down in parallel
+    for(const auto& name : names){
+        lock();
+        bool present = inMap(name, _taskMap);
+        unlock();
+        if(present){del(name);}
     }
     _taskMap.clear();
+    if(_lock != nullptr){vSemaphoreDelete(_lock);}
+    _lock = nullptr;
+    _arena.end();
+    if(_tcbs != nullptr){heap_caps_free(_tcbs);}
+    _tcbs = nullptr;
 }
 
 } // namespace Utils
\ No newline at end of file
@@ -10,23 +10,121 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/timers.h"
+#include "freertos/semphr.h"
 #include "esp_system.h"
 #include "esp_task_wdt.h"
 #include "esp_err.h"// Include ESP error codes
 #include "esp_log.h"// Add ESP logging support
 #include "esp_timer.h"// Include ESP timer support
+#include "esp_heap_caps.h"// Capability-based allocation for stack arenas
 #include <stdint.h>
 #include <string>
 #include <map>
+#include <vector>
+#include <atomic>
+#include <memory>
 #include <variant>
 #include <any>
 
+//Task notification index used to wake tasks blocked in taskManager::wait(), join() and shouldStop()
+#ifndef UTILS_NOTIFY_INDEX
+#define UTILS_NOTIFY_INDEX (configTASK_NOTIFICATION_ARRAY_ENTRIES - 1)
+#endif
+//Index 0 is the one xTaskNotifyGive()/ulTaskNotifyTake() use, so sharing it would eat other wake-ups.
+//Without a spare index (the sdkconfig default) those waits poll every UTILS_POLL_MS instead
+#if (UTILS_NOTIFY_INDEX > 0) && (UTILS_NOTIFY_INDEX < configTASK_NOTIFICATION_ARRAY_ENTRIES)
+#define UTILS_NOTIFY_WAKE 1
+#else
+#define UTILS_NOTIFY_WAKE 0
+#endif
+#ifndef UTILS_POLL_MS
+#define UTILS_POLL_MS 10
+#endif
+//Thread-local storage slot holding the cancellation token of managed tasks
+#ifndef UTILS_TLS_INDEX
+#define UTILS_TLS_INDEX (configNUM_THREAD_LOCAL_STORAGE_POINTERS - 1)
+#endif
+//Slot 0 holds the pthread keys of every task (ESP-IDF pthread component).
+//Without a spare slot (the sdkconfig default) tokens go to a table of UTILS_TOKEN_SLOTS entries
+#if (UTILS_TLS_INDEX > 0) && (UTILS_TLS_INDEX < configNUM_THREAD_LOCAL_STORAGE_POINTERS)
+#define UTILS_TLS_SLOT 1
+#else
+#define UTILS_TLS_SLOT 0
+#endif
+#ifndef UTILS_TOKEN_SLOTS
+#define UTILS_TOKEN_SLOTS 32// Managed tasks running at once, table mode only
+#endif
+//Time del() and the destructor give a task to stop on its own before deleting it
+#ifndef UTILS_JOIN_TIMEOUT_MS
+#define UTILS_JOIN_TIMEOUT_MS 100
+#endif
+//Core argument for add(): let the placement policy choose
+#ifndef UTILS_AUTO_CORE
+#define UTILS_AUTO_CORE ((BaseType_t)-2)
+#endif
+//Load (permille) assumed for a task placed since the last monitor sample
+#ifndef UTILS_PLACE_ESTIMATE
+#define UTILS_PLACE_ESTIMATE 100
+#endif
+//Core load gap (permille) above which the monitor migrates an auto-placed task (SMP FreeRTOS only)
+#ifndef UTILS_REBALANCE_PERMILLE
+#define UTILS_REBALANCE_PERMILLE 250
+#endif
+//Heartbeat slots available to taskManager::watch()
+#ifndef UTILS_MAX_WATCH
+#define UTILS_MAX_WATCH 16
+#endif
+//Monitor wake-up period - deadlines are checked with this resolution
+#ifndef UTILS_MONITOR_TICK_MS
+#define UTILS_MONITOR_TICK_MS 100
+#endif
+
 namespace Utils{
     template<typename T>
     inline bool inMap(const std::string& key, const std::map<std::string, T>& myMap){
         return myMap.find(key) != myMap.end();
     }
     //-----------------------------------------
+    //Stack Arena Class
+    /**
+     * @class stackArena
+     * @brief One preallocated block carved into task stacks (first fit, neighbours coalesced on release).
+     *
+     * Allocating every stack from the general heap fragments it over repeated create/delete cycles;
+     * an arena keeps stacks in one region of the requested capability (internal RAM or PSRAM).
+     */
+    class stackArena{
+    private:
+        struct block{
+            size_t offset;
+            size_t size;
+            bool used;
+        };
+        uint8_t* _base = nullptr;
+        size_t _size = 0;
+        uint32_t _caps = 0;
+        std::vector<block> _blocks;// Sorted by offset, covers the whole arena
+    public:
+        struct report{
+            size_t total;
+            size_t used;
+            size_t free;
+            size_t largestFree;
+            uint16_t usedBlocks;
+            uint16_t freeBlocks;
+            uint8_t fragmentation;// 0 = all free space contiguous, 100 = fully fragmented
+        };
+        static constexpr size_t ALIGN = 16;
+        stackArena(){};
+        bool begin(size_t bytes, uint32_t caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        bool ready() const {return _base != nullptr;}
+        uint32_t caps() const {return _caps;}
+        void* alloc(size_t bytes);
+        void release(void* ptr);
+        report stats();
+        void end();
+        ~stackArena();
+    };
     //-----------------------------------------
     //Task Manager Class
     /**
@@ -41,13 +139,38 @@ namespace Utils{
      *
      * Public Methods:
      * - taskManager(): Constructor.
-     * - void add(const std::string& name, TaskFunction_t taskFunc, void* param = NULL, UBaseType_t priority = 1, BaseType_t core = 0, uint32_t stackSize = 1024): Adds a new task.
-     * - void del(const std::string& name): Deletes a task by its name.
-     * - void resetWatchdog(const std::string& name): Resets the watchdog timer for a task by name.
+     * - bool add(const std::string& name, TaskFunction_t taskFunc, void* param = NULL, UBaseType_t priority = 1, BaseType_t core = UTILS_AUTO_CORE, uint32_t stackSize = 1024): Adds a new task; false if the name is taken or creation fails.
+     * - void setPlacement(placement policy): How tasks added with UTILS_AUTO_CORE are placed.
+     * - bool migrate(const std::string& name, BaseType_t core): Moves a running task to another core (SMP FreeRTOS).
+     * - void del(const std::string& name, TickType_t timeout): Cancels a task, joins it, deletes it if it does not stop in time.
+     * - bool cancel(const std::string& name): Requests cooperative cancellation.
+     * - bool join(const std::string& name, TickType_t timeout): Waits until a task has returned.
+     * - static bool shouldStop(TickType_t wait): Called by a managed task - true once it has been cancelled.
+     * - void resetWatchdog(const std::string& name): Feeds the heartbeat watched under this name (prefer beat()).
+     * - watchHandle watch(const std::string& name, uint32_t periodMs, bool critical): Registers a heartbeat deadline.
+     * - void beat(watchHandle handle): O(1) heartbeat from the watched task.
+     * - bool startPool(...): Starts a fixed pool of worker tasks pinned per core with work-stealing queues.
+     * - jobHandle submit(TaskFunction_t job, void* param, BaseType_t core): Queues a short job on the pool.
+     * - bool wait(jobHandle job, TickType_t timeout): Blocks until a submitted job has finished.
+     * - poolStats stats(): Queue depth, executed and steal counters per worker.
+     * - bool useArena(size_t bytes, uint32_t caps, uint8_t maxTasks): Create later tasks statically from a stack arena.
+     * - stackArena::report arenaReport(): Arena usage and fragmentation.
+     * - void startMonitor(uint32_t periodMs): Periodically samples stack high-water marks and CPU run time.
+     * - std::vector<taskReport> snapshot(): Per-task stack usage, recommended stack size and CPU share.
      * - ~taskManager(): Destructor.
      */
     class taskManager{
     private:
+    //Shared by the task entry trampoline and _taskMap - carries the cancellation token
+    struct taskControl{
+        taskManager* owner = nullptr;
+        TaskFunction_t func = nullptr;
+        void* param = NULL;
+        std::string name;
+        std::atomic<bool> cancel{false};
+        bool finished = false;// Task function returned - guarded by _lock
+        TaskHandle_t joiner = nullptr;// Task blocked in join() - guarded by _lock
+    };
     struct taskStruct{
         TaskHandle_t handle;
         std::string name;
@@ -55,17 +178,163 @@ namespace Utils{
         UBaseType_t priority = 1;
         BaseType_t core = 0;
         uint32_t stackSize = 1024;
+        StackType_t* stack = nullptr;// Arena stack when created statically
+        int16_t tcbSlot = -1;// Index in _tcbs when created statically
+        uint32_t minFreeStack = 0;// Stack high-water mark in bytes (lowest free stack seen)
+        uint32_t lastRunTime = 0;// Run-time counter at the previous sample
+        uint16_t cpuPermille = 0;// CPU share of its core during the last sample window
+        bool autoCore = false;// Placed by the policy - may be migrated
+        bool sampled = false;// Load measured by the monitor at least once (never without run-time stats)
+        std::shared_ptr<taskControl> control;
     };
     std::map <std::string, taskStruct> _taskMap;
+    stackArena _arena;
+    StaticTask_t* _tcbs = nullptr;// TCBs for static tasks - always internal RAM
+    std::vector<bool> _tcbUsed;
+    void releaseStatic(taskStruct& task);
+    static void taskEntry(void* param);
+    void taskReturned(taskControl* control);
+    void forget(const taskStruct& task);
+    void reap();
+    SemaphoreHandle_t _lock = nullptr;// Guards _taskMap against the monitor task
+    void lock();
+    void unlock();
+    uint32_t _lastTotalRunTime = 0;
+    uint16_t _coreLoadPermille[portNUM_PROCESSORS] = {0};
+    uint32_t _lastIdleRunTime[portNUM_PROCESSORS] = {0};
+    uint32_t _monitorPeriodMs = 1000;
+    BaseType_t pickCore();
+    void rebalance();
+    static void monitorLoop(void* param);
+    //Heartbeats: tasks beat() a slot, the monitor checks deadlines and feeds the hardware WDT
+    struct watchSlot{
+        std::string name;
+        std::atomic<TickType_t> last{0};// Tick of the latest beat
+        TickType_t period = 0;
+        bool critical = true;
+        bool used = false;
+        bool late = false;// Deadline currently missed - logged once per miss
+        uint16_t gen = 0;
+        uint32_t misses = 0;
+    };
+    watchSlot _watch[UTILS_MAX_WATCH];
+    portMUX_TYPE _watchLock = portMUX_INITIALIZER_UNLOCKED;
+    bool checkWatch();
     void statusTask(BaseType_t gpTaskResult, const char* TAG, const char* taskName);
+    //Worker pool: one bounded deque per worker, owner pops from the head (FIFO), idle workers steal from the tail
+    struct jobSlot{
+        TaskFunction_t func = nullptr;
+        void* param = NULL;
+        TaskHandle_t waiter = nullptr;
+        uint16_t gen = 0;// Bumped when the job finishes - invalidates its handle
+    };
+    struct poolWorker{
+        taskManager* owner = nullptr;
+        TaskHandle_t handle = nullptr;
+        std::string name;
+        BaseType_t core = 0;
+        uint8_t index = 0;
+        portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+        std::vector<uint16_t> ring;// Job slot indices
+        uint16_t head = 0;
+        uint16_t count = 0;
+        std::atomic<uint32_t> executed{0};
+        std::atomic<uint32_t> steals{0};
+        std::atomic<bool> idle{false};
+    };
+    std::vector<jobSlot> _jobs;
+    std::vector<uint16_t> _freeJobs;
+    portMUX_TYPE _jobLock = portMUX_INITIALIZER_UNLOCKED;
+    poolWorker* _workers = nullptr;
+    uint8_t _workerCount = 0;
+    std::atomic<uint32_t> _nextWorker{0};
+    std::atomic<uint32_t> _submitted{0};
+    std::atomic<uint32_t> _rejected{0};
+    std::atomic<bool> _poolRunning{false};// submit() accepts jobs - set once every worker exists
+    std::atomic<bool> _poolStopping{false};// Workers exit their loop
+    static void poolLoop(void* param);
+    bool pushJob(poolWorker& worker, uint16_t slot);
+    bool popJob(poolWorker& worker, uint16_t& slot);
+    bool stealJob(poolWorker& worker, uint16_t& slot);
+    void finishJob(uint16_t slot);
     public:
-        taskManager(){};
-        void add(const std::string& name, TaskFunction_t taskFunc, void* param = NULL, UBaseType_t priority = 1, BaseType_t core = 0, uint32_t stackSize = 1024);
-        //Delete task by name
-        void del(const std::string& name);
-        //Reset watchdog for a task by name
+        struct jobHandle{
+            uint16_t slot = 0xFFFF;
+            uint16_t gen = 0;
+            bool valid() const {return slot != 0xFFFF;}
+        };
+        struct workerStats{
+            BaseType_t core;
+            uint16_t depth;// Jobs waiting in this worker's queue
+            uint32_t executed;
+            uint32_t steals;// Jobs this worker took from other queues
+        };
+        struct poolStats{
+            uint32_t submitted;
+            uint32_t rejected;// submit() calls refused because the pool was full
+            uint32_t pending;// Jobs queued or running
+            std::vector<workerStats> workers;
+        };
+        struct taskReport{
+            std::string name;
+            BaseType_t core;
+            UBaseType_t priority;
+            uint32_t stackSize;
+            uint32_t minFreeStack;// Bytes never touched since the task started
+            uint32_t recommendedStack;// Measured peak usage plus a safety margin
+            uint16_t cpuPermille;// 0-1000 of its core over the last sample window
+            bool autoCore;// Core chosen by the placement policy
+        };
+        enum class placement : uint8_t {
+            CORE0,// Previous behaviour: UTILS_AUTO_CORE means core 0
+            LEAST_LOADED,// Pin to the core with the lowest measured load
+            FLOATING// tskNO_AFFINITY - the scheduler moves the task between cores
+        };
+        struct watchHandle{
+            uint16_t slot = 0xFFFF;
+            uint16_t gen = 0;
+            bool valid() const {return slot != 0xFFFF;}
+        };
+        taskManager();
+        bool add(const std::string& name, TaskFunction_t taskFunc, void* param = NULL, UBaseType_t priority = 1, BaseType_t core = UTILS_AUTO_CORE, uint32_t stackSize = 1024);
+        //Core placement for tasks added with UTILS_AUTO_CORE
+        void setPlacement(placement policy);
+        bool migrate(const std::string& name, BaseType_t core);
+        //Stop task by name: cancel, wait up to timeout for it to return, then force-delete
+        void del(const std::string& name, TickType_t timeout = pdMS_TO_TICKS(UTILS_JOIN_TIMEOUT_MS));
+        //Cooperative cancellation - the task polls cancelled()/shouldStop() and returns from its function
+        bool cancel(const std::string& name);
+        bool join(const std::string& name, TickType_t timeout = portMAX_DELAY);
+        static bool cancelled();
+        static bool shouldStop(TickType_t wait = 0);
+        //Feed the heartbeat watched under this name - kept for compatibility, beat() avoids the lookup
         void resetWatchdog(const std::string& name);
+        //Heartbeat deadlines - a critical task missing its deadline stops the monitor feeding the hardware WDT
+        watchHandle watch(const std::string& name, uint32_t periodMs, bool critical = true);
+        void beat(watchHandle handle);
+        void unwatch(watchHandle handle);
+        bool healthy();// All critical heartbeats within their deadline
+        uint32_t misses(watchHandle handle);
+        //Worker pool for short-lived jobs - avoids creating a task per job
+        bool startPool(uint8_t workersPerCore = 1, UBaseType_t priority = 5, uint32_t stackSize = 4096, uint16_t maxJobs = 32);
+        jobHandle submit(TaskFunction_t job, void* param = NULL, BaseType_t core = tskNO_AFFINITY);
+        bool done(jobHandle job);
+        bool wait(jobHandle job, TickType_t timeout = portMAX_DELAY);
+        poolStats stats();
+        void stopPool();
+        //Static task creation - stacks from a preallocated arena, TCB slots reused after del()
+        bool useArena(size_t bytes, uint32_t caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT, uint8_t maxTasks = 16);
+        stackArena::report arenaReport();
+        //Profiler - stack high-water marks and run-time stats of every managed task
+        void startMonitor(uint32_t periodMs = 1000, UBaseType_t priority = 1, BaseType_t core = tskNO_AFFINITY);
+        void sample();
+        std::vector<taskReport> snapshot();
+        uint16_t coreLoad(BaseType_t core);// Permille busy over the last sample window
+        size_t snapshotJson(char* buf, size_t len);
+        static uint32_t recommendStack(uint32_t stackSize, uint32_t minFreeStack);
         ~taskManager();
+    private:
+        placement _placement = placement::LEAST_LOADED;// Declared after the public enum
   };
 }
 #endif // UTILS_H
\ No newline at end of file
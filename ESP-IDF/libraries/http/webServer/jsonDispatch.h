@@ -0,0 +1,222 @@
+#ifndef JSON_DISPATCH_H
+#define JSON_DISPATCH_H
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+/*
+JSON-aware API dispatch.
+
+jsonField pulls the value of one top-level key out of a JSON object while
+the body streams in - one character at a time, no allocation, no copy of
+the body. dispatchTable maps that value to a handler with a binary search
+over precomputed hashes. Together they replace the substring scan, which
+costs O(options x body) and matches "on" inside "connection".
+
+Neither class depends on ESP-IDF, so both also build on a host.
+*/
+#ifndef WEB_JSON_VALUE
+#define WEB_JSON_VALUE 32// Longest field value that can be dispatched on
+#endif
+
+//FNV-1a: cheap, and good enough to spread a few dozen command names
+inline uint32_t jsonHash(const char* data, size_t len){
+    uint32_t hash = 2166136261u;
+    for(size_t i = 0; i < len; i++){
+        hash ^= (uint8_t)data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+//-----------------------------------------
+//Incremental top-level field extractor
+//-----------------------------------------
+class jsonField{
+    public:
+        enum class status{SCANNING, FOUND, TOO_LONG, INVALID};
+    private:
+        const char* _name;
+        size_t _nameLen;
+        status _status = status::SCANNING;
+        uint16_t _depth = 0;
+        bool _started = false;// Saw the opening '{'
+        bool _inString = false;
+        bool _escape = false;
+        bool _expectKey = false;// Next string at depth 1 is a key
+        bool _isKey = false;// Current string is a key
+        bool _keyMatch = false;
+        size_t _keyPos = 0;
+        bool _capture = false;// Next value at depth 1 belongs to the field
+        bool _inValue = false;// Capturing the value
+        char _value[WEB_JSON_VALUE];
+        size_t _len = 0;
+
+        void keyChar(char c){
+            if(_keyMatch && _keyPos < _nameLen && _name[_keyPos] == c){
+                _keyPos++;
+            } else {
+                _keyMatch = false;
+            }
+        }
+        void valueChar(char c){
+            if(_len >= WEB_JSON_VALUE - 1){
+                _status = status::TOO_LONG;
+                return;
+            }
+            _value[_len++] = c;
+        }
+        void finish(){
+            _value[_len] = '\0';
+            _status = status::FOUND;
+        }
+        char unescape(char c){
+            switch(c){
+                case 'n': return '\n';
+                case 't': return '\t';
+                case 'r': return '\r';
+                case 'b': return '\b';
+                case 'f': return '\f';
+                case 'u': _status = status::INVALID; return 0;// \uXXXX is not decoded
+                default: return c;// \" \\ \/
+            }
+        }
+        void step(char c){
+            if(_inString){
+                if(_escape){
+                    _escape = false;
+                    c = unescape(c);
+                    if(_status != status::SCANNING){return;}
+                } else if(c == '\\'){
+                    _escape = true;
+                    return;
+                } else if(c == '"'){
+                    _inString = false;
+                    if(_isKey){
+                        _isKey = false;
+                        _capture = _keyMatch && _keyPos == _nameLen;
+                    } else if(_inValue){
+                        finish();
+                    }
+                    return;
+                }
+                if(_isKey){keyChar(c);}
+                else if(_inValue){valueChar(c);}
+                return;
+            }
+            if(!_started){
+                if(c == '{'){
+                    _started = true;
+                    _depth = 1;
+                    _expectKey = true;
+                } else if(c != ' ' && c != '\t' && c != '\r' && c != '\n'){
+                    _status = status::INVALID;// Not an object
+                }
+                return;
+            }
+            switch(c){
+                case ' ': case '\t': case '\r': case '\n':
+                    if(_inValue){finish();}
+                    return;
+                case '"':
+                    _inString = true;
+                    if(_depth == 1 && _expectKey){
+                        _isKey = true;
+                        _keyMatch = true;
+                        _keyPos = 0;
+                    } else if(_depth == 1 && _capture){
+                        _inValue = true;
+                    }
+                    return;
+                case '{': case '[':
+                    if(_depth == 1){_capture = false;}// Objects and arrays are not dispatch values
+                    _depth++;
+                    return;
+                case '}': case ']':
+                    if(_inValue){
+                        finish();
+                        return;
+                    }
+                    if(_depth == 0){_status = status::INVALID; return;}
+                    _depth--;
+                    if(_depth == 0){_status = status::INVALID;}// Object closed without the field
+                    return;
+                case ':':
+                    if(_depth == 1){_expectKey = false;}
+                    return;
+                case ',':
+                    if(_inValue){
+                        finish();
+                        return;
+                    }
+                    if(_depth == 1){
+                        _expectKey = true;
+                        _capture = false;
+                    }
+                    return;
+                default:// Numbers, true, false, null
+                    if(_depth == 1 && _capture){
+                        _inValue = true;
+                        valueChar(c);
+                    }
+                    return;
+            }
+        }
+    public:
+        explicit jsonField(const char* name) : _name(name), _nameLen(strlen(name)){_value[0] = '\0';}
+        //Feed the next chunk - returns false once the value is known or the body cannot contain it
+        bool feed(const char* data, size_t len){
+            for(size_t i = 0; i < len && _status == status::SCANNING; i++){
+                if(_inString && !_escape && !_inValue && (!_isKey || !_keyMatch)){// Skip strings we do not care about in a tight loop
+                    while(i < len && data[i] != '"' && data[i] != '\\'){i++;}
+                    if(i == len){break;}
+                }
+                step(data[i]);
+            }
+            return _status == status::SCANNING;
+        }
+        status state() const {return _status;}
+        bool found() const {return _status == status::FOUND;}
+        //String values are unescaped, scalars are kept as written ("42", "true")
+        const char* value() const {return _value;}
+        size_t length() const {return _len;}
+};
+//-----------------------------------------
+//Sorted hash table
+//-----------------------------------------
+/*
+Entries are (hash, key, value) sorted by hash once, after all routes are
+added. find() is a binary search plus one strcmp-equivalent, and never
+allocates. Keys are not copied and must outlive the table.
+*/
+template<typename T>
+class dispatchTable{
+    private:
+        struct entry{
+            uint32_t hash;
+            const char* key;
+            size_t keyLen;
+            T value;
+        };
+        std::vector<entry> _entries;
+    public:
+        void clear(){_entries.clear();}
+        void add(const char* key, T value){
+            size_t len = strlen(key);
+            _entries.push_back({jsonHash(key, len), key, len, value});
+        }
+        //Call once after the last add() - find() needs sorted entries
+        void build(){
+            std::stable_sort(_entries.begin(), _entries.end(), [](const entry& a, const entry& b){return a.hash < b.hash;});
+        }
+        const T* find(const char* key, size_t len) const {
+            uint32_t hash = jsonHash(key, len);
+            auto it = std::lower_bound(_entries.begin(), _entries.end(), hash, [](const entry& e, uint32_t h){return e.hash < h;});
+            for(; it != _entries.end() && it->hash == hash; ++it){// Collisions are compared in full
+                if(it->keyLen == len && memcmp(it->key, key, len) == 0){return &it->value;}
+            }
+            return nullptr;
+        }
+        size_t size() const {return _entries.size();}
+};
+#endif // JSON_DISPATCH_H
@@ -0,0 +1,199 @@
+#include "pushChannel.h"
+#include "esp_log.h"
+#include "../../Utils/Logger.h"
+#include <string.h>
+#include <sys/socket.h>
+
+#define PUSH_TAG "pushChannel"
+
+pushChannel::pushChannel(){
+    _lock = xSemaphoreCreateMutex();
+}
+pushChannel::~pushChannel(){
+    if(_retry != nullptr){
+        esp_timer_stop(_retry);
+        esp_timer_delete(_retry);
+    }
+    vSemaphoreDelete(_lock);
+}
+void pushChannel::attach(httpd_handle_t server){
+    _server = server;
+    _scheduled.store(false, std::memory_order_release);// Work queued on a stopped server never ran
+    if(server == nullptr){// Detach before httpd_stop(): retries and publish() stop touching the handle
+        if(_retry != nullptr){esp_timer_stop(_retry);}
+        return;
+    }
+    if(_retry == nullptr){
+        esp_timer_create_args_t args = {};
+        args.callback = _retryTimer;
+        args.arg = this;
+        args.name = "pushRetry";
+        if(esp_timer_create(&args, &_retry) != ESP_OK){ESP_LOGE(PUSH_TAG, "Failed to create retry timer");}
+    }
+}
+//Unmasked text frame, FIN set. False when the payload does not fit a 16-bit length
+bool pushChannel::frameWs(message& msg){
+    size_t len = msg.payload.size();
+    uint8_t header[4] = {0x81, 0, 0, 0};
+    size_t headerLen = 2;
+    if(len < 126){
+        header[1] = (uint8_t)len;
+    } else if(len <= 0xFFFF){
+        header[1] = 126;
+        header[2] = (uint8_t)(len >> 8);
+        header[3] = (uint8_t)len;
+        headerLen = 4;
+    } else {
+        return false;
+    }
+    msg.ws.reserve(headerLen + len);
+    msg.ws.append((const char*)header, headerLen);
+    msg.ws.append(msg.payload);
+    return true;
+}
+//Every line of the payload needs its own "data: "
+void pushChannel::frameSse(message& msg){
+    const char* line = msg.payload.data();
+    const char* end = line + msg.payload.size();
+    msg.sse.reserve(msg.payload.size() + 16);
+    while(line < end){
+        const char* next = (const char*)memchr(line, '\n', end - line);
+        if(next == nullptr){next = end;}
+        msg.sse.append("data: ");
+        msg.sse.append(line, next - line);
+        msg.sse.append("\n");
+        line = next + 1;
+    }
+    msg.sse.append("\n");
+}
+bool pushChannel::publish(const char* payload, size_t len){
+    if(payload == nullptr){return false;}
+    if(len == 0){len = strlen(payload);}
+    auto msg = std::make_shared<message>();
+    msg->payload.assign(payload, len);
+    if(_wsClients.load(std::memory_order_relaxed) > 0 && !frameWs(*msg)){
+        ESP_LOGW(PUSH_TAG, "Payload of %u bytes is too large to push", (unsigned)len);
+        return false;
+    }
+    if(_sseClients.load(std::memory_order_relaxed) > 0){frameSse(*msg);}
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    msg->version = ++_version;
+    _latest = msg;
+    xSemaphoreGive(_lock);
+    _published.fetch_add(1, std::memory_order_relaxed);
+    schedule();
+    return true;
+}
+void pushChannel::schedule(){
+    httpd_handle_t server = _server;
+    if(server == nullptr){return;}
+    if(_scheduled.exchange(true, std::memory_order_acq_rel)){return;}// A pump is already queued
+    if(httpd_queue_work(server, _pumpWork, this) != ESP_OK){_scheduled.store(false, std::memory_order_release);}
+}
+void pushChannel::_pumpWork(void* arg){
+    pushChannel* channel = (pushChannel*)arg;
+    channel->_scheduled.store(false, std::memory_order_release);
+    channel->pump();
+}
+void pushChannel::_retryTimer(void* arg){((pushChannel*)arg)->schedule();}
+
+//httpd task: the latest message with a frame for every client type that still has to receive it
+std::shared_ptr<const pushChannel::message> pushChannel::complete(std::shared_ptr<const message> latest){
+    bool needWs = false, needSse = false;
+    for(const client& c : _clients){
+        if(c.fd < 0 || c.sent == latest->version || c.pending == latest){continue;}
+        if(c.sse){needSse |= latest->sse.empty();} else {needWs |= latest->ws.empty();}
+    }
+    if(!needWs && !needSse){return latest;}
+    auto full = std::make_shared<message>(*latest);// Clients may be sending from latest, so it is not changed in place
+    if(needWs && !frameWs(*full)){DLOGW(PUSH_TAG, "Payload of %u bytes is too large for WebSocket", (unsigned)full->payload.size());}
+    if(needSse){frameSse(*full);}
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    if(_latest == latest){_latest = full;}// A newer publish() already framed its own
+    xSemaphoreGive(_lock);
+    return full;
+}
+//httpd task: write as much as each socket accepts without blocking
+void pushChannel::pump(){
+    httpd_handle_t server = _server;
+    if(server == nullptr){return;}
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    std::shared_ptr<const message> latest = _latest;
+    xSemaphoreGive(_lock);
+    if(latest){latest = complete(latest);}
+    int64_t now = esp_timer_get_time();
+    bool again = false;
+    for(client& c : _clients){
+        while(c.fd >= 0){// Until the socket is full or the client is up to date
+            if(!c.pending){
+                if(!latest || c.sent == latest->version){break;}
+                if(c.sent != 0 && latest->version - c.sent > 1){_coalesced.fetch_add(latest->version - c.sent - 1, std::memory_order_relaxed);}
+                c.pending = latest;
+                c.offset = 0;
+            }
+            const std::string& bytes = c.sse ? c.pending->sse : c.pending->ws;
+            if(bytes.empty()){// Too large for a WebSocket frame
+                c.sent = c.pending->version;
+                c.pending.reset();
+                continue;
+            }
+            int ret = httpd_socket_send(server, c.fd, bytes.data() + c.offset, bytes.size() - c.offset, MSG_DONTWAIT);
+            if(ret > 0){
+                c.offset += ret;
+                c.lastProgress = now;
+                httpd_sess_update_lru_counter(server, c.fd);// Idle push sockets would be the first ones purged
+            } else if(ret != HTTPD_SOCK_ERR_TIMEOUT){// Socket error - EAGAIN maps to timeout
+                drop(server, c);
+                break;
+            }
+            if(c.offset == bytes.size()){
+                c.sent = c.pending->version;
+                c.pending.reset();
+                _sent.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            if(now - c.lastProgress > (int64_t)WEB_PUSH_STALL_MS * 1000){
+                DLOGW(PUSH_TAG, "Client %d stalled, disconnecting", c.fd);
+                drop(server, c);
+            } else {
+                again = true;// Socket buffer full - resume later
+            }
+            break;
+        }
+    }
+    if(again && _server != nullptr && _retry != nullptr && !esp_timer_is_active(_retry)){esp_timer_start_once(_retry, WEB_PUSH_RETRY_MS * 1000);}
+}
+void pushChannel::drop(httpd_handle_t server, client& c){
+    _dropped.fetch_add(1, std::memory_order_relaxed);
+    httpd_sess_trigger_close(server, c.fd);// close_fn calls unsubscribe()
+    unsubscribe(c.fd);
+}
+bool pushChannel::subscribe(int fd, bool sse){
+    for(client& c : _clients){
+        if(c.fd == fd){return true;}
+    }
+    for(client& c : _clients){
+        if(c.fd >= 0){continue;}
+        c = client();
+        c.fd = fd;
+        c.sse = sse;
+        c.lastProgress = esp_timer_get_time();
+        (sse ? _sseClients : _wsClients).fetch_add(1, std::memory_order_relaxed);
+        schedule();// Send the current value right away instead of waiting for the next publish()
+        return true;
+    }
+    ESP_LOGW(PUSH_TAG, "No free push slot for socket %d (WEB_PUSH_CLIENTS=%d)", fd, WEB_PUSH_CLIENTS);
+    return false;
+}
+void pushChannel::unsubscribe(int fd){
+    for(client& c : _clients){
+        if(c.fd != fd){continue;}
+        (c.sse ? _sseClients : _wsClients).fetch_sub(1, std::memory_order_relaxed);
+        c = client();
+    }
+}
+pushChannel::pushStats pushChannel::stats() const {
+    return {_published.load(std::memory_order_relaxed), _sent.load(std::memory_order_relaxed),
+            _coalesced.load(std::memory_order_relaxed), _dropped.load(std::memory_order_relaxed),
+            (uint8_t)(_wsClients.load(std::memory_order_relaxed) + _sseClients.load(std::memory_order_relaxed))};
+}
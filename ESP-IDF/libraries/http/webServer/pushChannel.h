@@ -0,0 +1,100 @@
+#ifndef PUSH_CHANNEL_H
+#define PUSH_CHANNEL_H
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "esp_http_server.h"
+#include "sdkconfig.h"
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <string>
+/*
+Server push for live telemetry: WebSocket clients and Server-Sent Events
+(SSE) clients subscribe to a channel, publish() sends to all of them.
+
+- One serialization: publish() frames the payload once as a WebSocket
+  frame and once as an SSE event (only the forms that have clients), and
+  every client sends from that shared buffer. A form that is missing when
+  its first client subscribes is built once, on the httpd task.
+- Coalescing: each client only ever holds the newest message. A client
+  that is still sending an older one skips to the latest when it is done,
+  so a slow dashboard sees fewer updates instead of older ones.
+- Backpressure: sockets are written with MSG_DONTWAIT from the httpd task.
+  A partial write is resumed later, and a client that makes no progress
+  for WEB_PUSH_STALL_MS is disconnected. A slow client never blocks the
+  server or the other clients.
+- Sending to a client counts as activity for httpd's LRU purge, so a
+  subscriber is only purged once it has been idle longer than the
+  request sockets (see setLruPurge()).
+
+WebSocket endpoints need CONFIG_HTTPD_WS_SUPPORT=y; SSE works without it.
+*/
+#ifndef WEB_PUSH_CLIENTS
+#define WEB_PUSH_CLIENTS 8// Subscribers per channel
+#endif
+#ifndef WEB_PUSH_RETRY_MS
+#define WEB_PUSH_RETRY_MS 20// Resume interval for clients with a partial write
+#endif
+#ifndef WEB_PUSH_STALL_MS
+#define WEB_PUSH_STALL_MS 5000// No progress for this long disconnects the client
+#endif
+
+class pushChannel{
+    public:
+        struct pushStats{
+            uint32_t published;// publish() calls
+            uint32_t sent;// Messages fully written to a client
+            uint32_t coalesced;// Messages a client skipped because a newer one replaced them
+            uint32_t dropped;// Clients disconnected for stalling or socket errors
+            uint8_t clients;
+        };
+        pushChannel();
+        pushChannel(const pushChannel&) = delete;
+        ~pushChannel();
+        //Any task: len = 0 uses strlen. The payload is copied, so it can be a stack buffer
+        bool publish(const char* payload, size_t len = 0);
+        pushStats stats() const;
+        //Called by serverManager: attach() from begin()/stop() (nullptr detaches), the rest on the httpd task
+        void attach(httpd_handle_t server);
+        bool subscribe(int fd, bool sse);
+        void unsubscribe(int fd);
+    private:
+        struct message{
+            uint32_t version;
+            std::string payload;// Kept so a client type that subscribes later can be framed on demand
+            std::string ws;// Complete WebSocket text frame
+            std::string sse;// Complete "data: ...\n\n" event
+        };
+        struct client{
+            int fd = -1;
+            bool sse = false;
+            uint32_t sent = 0;// Version of the last message fully written
+            std::shared_ptr<const message> pending;// Message being written
+            size_t offset = 0;
+            int64_t lastProgress = 0;
+        };
+        std::atomic<httpd_handle_t> _server{nullptr};// Cleared by attach(nullptr) from the task that stops the server
+        SemaphoreHandle_t _lock;// Guards _latest only
+        std::shared_ptr<const message> _latest;
+        uint32_t _version = 0;
+        client _clients[WEB_PUSH_CLIENTS];// httpd task only
+        std::atomic<uint8_t> _wsClients{0};
+        std::atomic<uint8_t> _sseClients{0};
+        std::atomic<bool> _scheduled{false};
+        esp_timer_handle_t _retry = nullptr;
+        std::atomic<uint32_t> _published{0};
+        std::atomic<uint32_t> _sent{0};
+        std::atomic<uint32_t> _coalesced{0};
+        std::atomic<uint32_t> _dropped{0};
+        void schedule();
+        void pump();
+        std::shared_ptr<const message> complete(std::shared_ptr<const message> latest);
+        static bool frameWs(message& msg);
+        static void frameSse(message& msg);
+        void drop(httpd_handle_t server, client& c);
+        static void _pumpWork(void* arg);
+        static void _retryTimer(void* arg);
+};
+#endif // PUSH_CHANNEL_H
@@ -0,0 +1,102 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+#include <stdint.h>
+#include <stddef.h>
+/*
+Token buckets for request admission.
+
+A bucket holds up to burst tokens and refills at perSecond tokens per
+second; each request takes one. Tokens are kept in thousandths so rates
+below one request per second work without floating point on the request
+path. Time is passed in (microseconds, esp_timer_get_time() on the
+device), so the buckets also run on a host.
+
+clientTable keeps one bucket per client address in a fixed array. A new
+client takes the entry that was used least recently - an idle client's
+bucket has refilled by then, so forgetting it changes nothing. Lookups
+are a linear scan over WEB_RATE_CLIENTS keys, cheaper than hashing at
+this size. Neither class locks: serverManager only touches them from the
+httpd task.
+*/
+#ifndef WEB_RATE_CLIENTS
+#define WEB_RATE_CLIENTS 16// Client addresses tracked at once
+#endif
+
+struct rateLimit{
+    uint32_t rate = 0;// Thousandths of a token per second, 0: unlimited
+    uint32_t burst = 0;// Thousandths of a token
+    rateLimit() = default;
+    rateLimit(float perSecond, uint16_t burstRequests){set(perSecond, burstRequests);}
+    void set(float perSecond, uint16_t burstRequests){
+        rate = (perSecond > 0) ? (uint32_t)(perSecond * 1000.0f + 0.5f) : 0;
+        if(rate == 0 && perSecond > 0){rate = 1;}
+        burst = (uint32_t)(burstRequests > 0 ? burstRequests : 1) * 1000;
+    }
+    bool enabled() const {return rate > 0;}
+};
+
+struct tokenBucket{
+    uint32_t tokens = 0;// Thousandths
+    int64_t last = 0;// Time the tokens were refilled up to, 0: never used - starts full
+    //Takes one token; false when empty, with *retryMs set to the wait for the next one
+    bool take(const rateLimit& limit, int64_t now, uint32_t* retryMs = nullptr){
+        if(!limit.enabled()){return true;}
+        if(last == 0){
+            tokens = limit.burst;
+            last = now;
+        } else if(now > last){
+            uint64_t refill = (uint64_t)(now - last) * limit.rate / 1000000;
+            if(tokens + refill >= limit.burst){
+                tokens = limit.burst;
+                last = now;// Full: time spent full earns nothing
+            } else {
+                tokens += (uint32_t)refill;
+                last += (int64_t)(refill * 1000000 / limit.rate);// Keep the time that did not make a whole thousandth yet
+            }
+        }
+        if(tokens >= 1000){
+            tokens -= 1000;
+            return true;
+        }
+        if(retryMs != nullptr){*retryMs = (uint32_t)(((uint64_t)(1000 - tokens) * 1000 + limit.rate - 1) / limit.rate);}
+        return false;
+    }
+};
+
+class clientTable{
+    private:
+        struct entry{
+            uint32_t key = 0;
+            tokenBucket bucket;
+        };
+        entry _entries[WEB_RATE_CLIENTS];
+        size_t _used = 0;
+        uint32_t _evictions = 0;
+    public:
+        //The bucket for key, taking over the least recently used entry when key is new
+        tokenBucket& bucket(uint32_t key){
+            for(size_t i = 0; i < _used; i++){
+                if(_entries[i].key == key){return _entries[i].bucket;}
+            }
+            size_t slot = _used;
+            if(_used < WEB_RATE_CLIENTS){
+                _used++;
+            } else {
+                slot = 0;
+                for(size_t i = 1; i < WEB_RATE_CLIENTS; i++){
+                    if(_entries[i].bucket.last < _entries[slot].bucket.last){slot = i;}
+                }
+                _evictions++;
+            }
+            _entries[slot].key = key;
+            _entries[slot].bucket = tokenBucket();
+            return _entries[slot].bucket;
+        }
+        void clear(){
+            _used = 0;
+            _evictions = 0;
+        }
+        size_t clients() const {return _used;}
+        uint32_t evictions() const {return _evictions;}
+};
+#endif // RATE_LIMITER_H
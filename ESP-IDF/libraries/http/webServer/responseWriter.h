@@ -0,0 +1,206 @@
+#ifndef RESPONSE_WRITER_H
+#define RESPONSE_WRITER_H
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+/*
+Streaming responses without building the page in RAM.
+
+responseWriter collects small writes in a caller-provided scratch buffer
+and hands full buffers to a sink (httpd_resp_send_chunk on the device).
+Writes at least half the buffer long skip the copy and go to the sink
+directly, so large flash-resident text is never copied.
+
+webTemplate compiles "{{name}}" placeholders once into a list of literal
+slices of the source and field slots. render() walks that list: literals
+are written as-is, fields call the callback bound to their name, which
+writes the value straight into the response. The page never exists as a
+whole, and neither the source nor the values are copied on the heap.
+
+Neither class depends on ESP-IDF, so both also build on a host.
+*/
+class responseWriter{
+    public:
+        //Returns false to abort the response (socket closed); len = 0 marks the end
+        typedef bool (*sinkFn)(void* ctx, const char* data, size_t len);
+    private:
+        sinkFn _sink;
+        void* _ctx;
+        char* _buf;
+        size_t _size;
+        size_t _used = 0;
+        size_t _total = 0;
+        bool _ok = true;
+        bool _finished = false;
+    public:
+        responseWriter(sinkFn sink, void* ctx, char* scratch, size_t size) : _sink(sink), _ctx(ctx), _buf(scratch), _size(size){}
+        responseWriter(const responseWriter&) = delete;
+        bool flush(){
+            if(_used > 0 && _ok){_ok = _sink(_ctx, _buf, _used);}
+            _used = 0;
+            return _ok;
+        }
+        bool write(const char* data, size_t len){
+            if(!_ok || len == 0){return _ok;}
+            _total += len;
+            if(len >= _size / 2){// Zero-copy: flush what is buffered, then send the caller's bytes as their own chunk
+                if(!flush()){return false;}
+                _ok = _sink(_ctx, data, len);
+                return _ok;
+            }
+            if(_used + len > _size && !flush()){return false;}
+            memcpy(_buf + _used, data, len);
+            _used += len;
+            return true;
+        }
+        bool print(const char* text){return text != nullptr ? write(text, strlen(text)) : _ok;}
+        //Formatted straight into the scratch buffer; output longer than the buffer is truncated
+        bool printf(const char* format, ...) __attribute__((format(printf, 2, 3))){
+            if(!_ok){return false;}
+            for(int attempt = 0; attempt < 2; attempt++){
+                va_list args;
+                va_start(args, format);
+                int len = vsnprintf(_buf + _used, _size - _used, format, args);
+                va_end(args);
+                if(len < 0){return _ok;}
+                if((size_t)len < _size - _used){
+                    _used += len;
+                    _total += len;
+                    return true;
+                }
+                if(attempt == 0 && _used > 0){// Did not fit behind the buffered data - flush and retry once
+                    if(!flush()){return false;}
+                    continue;
+                }
+                _used = _size - 1;// Buffer holds the truncated text
+                _total += _used;
+                return flush();
+            }
+            return _ok;
+        }
+        //HTML-escaped text for values that come from users or sensors
+        bool html(const char* text, size_t len = 0){
+            if(text == nullptr){return _ok;}
+            if(len == 0){len = strlen(text);}
+            size_t start = 0;
+            for(size_t i = 0; i < len && _ok; i++){
+                const char* entity;
+                switch(text[i]){
+                    case '&': entity = "&amp;"; break;
+                    case '<': entity = "&lt;"; break;
+                    case '>': entity = "&gt;"; break;
+                    case '"': entity = "&quot;"; break;
+                    case '\'': entity = "&#39;"; break;
+                    default: continue;
+                }
+                write(text + start, i - start);
+                write(entity, strlen(entity));
+                start = i + 1;
+            }
+            return write(text + start, len - start);
+        }
+        //Flushes and sends the end marker - once
+        bool finish(){
+            if(_finished){return _ok;}
+            _finished = true;
+            if(!flush()){return false;}
+            _ok = _sink(_ctx, nullptr, 0);
+            return _ok;
+        }
+        bool ok() const {return _ok;}
+        size_t bytes() const {return _total;}
+};
+//-----------------------------------------
+//Precompiled template
+//-----------------------------------------
+class webTemplate{
+    public:
+        typedef void (*fieldFn)(responseWriter& out, void* ctx);
+    private:
+        struct segment{
+            const char* text;// Literal slice of the source
+            size_t len;
+            int16_t field;// -1: literal
+        };
+        struct field{
+            const char* name;// Slice of the source
+            size_t nameLen;
+            fieldFn fn = nullptr;
+        };
+        std::vector<segment> _segments;
+        std::vector<field> _fields;
+        int16_t fieldIndex(const char* name, size_t len){
+            for(size_t i = 0; i < _fields.size(); i++){
+                if(_fields[i].nameLen == len && memcmp(_fields[i].name, name, len) == 0){return i;}
+            }
+            _fields.push_back({name, len});
+            return _fields.size() - 1;
+        }
+        static void trim(const char*& name, size_t& len){
+            while(len > 0 && name[0] == ' '){name++; len--;}
+            while(len > 0 && name[len - 1] == ' '){len--;}
+        }
+    public:
+        //source is not copied and must outlive the template - a literal or an EMBED_FILES symbol. len = 0 uses strlen
+        explicit webTemplate(const char* source, size_t len = 0){
+            if(source == nullptr){return;}
+            if(len == 0){len = strlen(source);}
+            const char* p = source;
+            const char* end = source + len;
+            while(p < end){
+                const char* open = nullptr;
+                for(const char* s = p; s + 1 < end; s++){
+                    if(s[0] == '{' && s[1] == '{'){open = s; break;}
+                }
+                const char* close = nullptr;
+                if(open != nullptr){
+                    for(const char* s = open + 2; s + 1 < end; s++){
+                        if(s[0] == '}' && s[1] == '}'){close = s; break;}
+                    }
+                }
+                if(close == nullptr){// No more placeholders - the rest is literal
+                    _segments.push_back({p, (size_t)(end - p), -1});
+                    break;
+                }
+                if(open > p){_segments.push_back({p, (size_t)(open - p), -1});}
+                const char* name = open + 2;
+                size_t nameLen = close - name;
+                trim(name, nameLen);
+                _segments.push_back({nullptr, 0, fieldIndex(name, nameLen)});
+                p = close + 2;
+            }
+        }
+        //Every {{name}} in the template calls fn; false when the template has no such field
+        bool bind(const char* name, fieldFn fn){
+            size_t len = strlen(name);
+            for(field& f : _fields){
+                if(f.nameLen == len && memcmp(f.name, name, len) == 0){
+                    f.fn = fn;
+                    return true;
+                }
+            }
+            return false;
+        }
+        //Unbound fields render as nothing. Does not call out.finish()
+        bool render(responseWriter& out, void* ctx) const {
+            for(const segment& s : _segments){
+                if(!out.ok()){break;}
+                if(s.field < 0){
+                    out.write(s.text, s.len);
+                } else if(_fields[s.field].fn != nullptr){
+                    _fields[s.field].fn(out, ctx);
+                }
+            }
+            return out.ok();
+        }
+        size_t fields() const {return _fields.size();}
+        size_t unbound() const {
+            size_t n = 0;
+            for(const field& f : _fields){n += (f.fn == nullptr);}
+            return n;
+        }
+};
+#endif // RESPONSE_WRITER_H
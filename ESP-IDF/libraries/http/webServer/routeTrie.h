@@ -0,0 +1,194 @@
+#ifndef ROUTE_TRIE_H
+#define ROUTE_TRIE_H
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+/*
+Path router compiled once at begin().
+
+Patterns are split on '/' into segments:
+- "pin"     literal segment
+- "{name}"  any one segment, captured as parameter "name"
+- "*"       last segment only: the rest of the path (zero or more segments), captured as "*"
+
+Literals win over parameters, parameters over wildcards, whatever the
+registration order. match() walks the path once; each level is a binary
+search over the literal children, so a lookup costs O(path length) for
+any number of routes. Captured values point into the path - no copies.
+
+Empty segments are ignored ("/a//b/" is "/a/b") and matching stops at '?'
+or '#'. Values are not URL-decoded. Like jsonDispatch.h, this builds on a
+host.
+*/
+#ifndef WEB_ROUTE_PARAMS
+#define WEB_ROUTE_PARAMS 4// Parameters captured per request
+#endif
+
+struct routeParams{
+    struct param{
+        const char* name;// Owned by the trie
+        const char* value;// Points into the path, not null-terminated
+        size_t len;
+    };
+    param items[WEB_ROUTE_PARAMS];
+    size_t count = 0;
+    //nullptr when the route has no such parameter
+    const char* get(const char* name, size_t* len) const {
+        for(size_t i = 0; i < count; i++){
+            if(strcmp(items[i].name, name) == 0){
+                if(len != nullptr){*len = items[i].len;}
+                return items[i].value;
+            }
+        }
+        return nullptr;
+    }
+    //Null-terminated copy; false when missing or truncated
+    bool copy(const char* name, char* buf, size_t size) const {
+        size_t len = 0;
+        const char* value = get(name, &len);
+        if(value == nullptr || size == 0){
+            if(size > 0){buf[0] = '\0';}
+            return false;
+        }
+        size_t n = (len < size - 1) ? len : size - 1;
+        memcpy(buf, value, n);
+        buf[n] = '\0';
+        return n == len;
+    }
+};
+
+template<typename T>
+class routeTrie{
+    private:
+        struct node{
+            std::vector<std::pair<std::string, uint16_t>> children;// Literal segments, sorted by build()
+            int32_t param = -1;// Child for "{name}"
+            std::string paramName;
+            int32_t wildcard = -1;// Child for "*"
+            bool hasValue = false;
+            T value{};
+        };
+        std::vector<node> _nodes;
+        bool _built = false;
+
+        static bool nextSegment(const char*& p, const char* end, const char*& seg, size_t& len){
+            while(p < end && *p == '/'){p++;}
+            if(p >= end){return false;}
+            seg = p;
+            while(p < end && *p != '/'){p++;}
+            len = p - seg;
+            return true;
+        }
+        static const char* pathEnd(const char* path){
+            return path + strcspn(path, "?#");
+        }
+        int32_t literal(uint32_t at, const char* seg, size_t len) const {
+            const auto& children = _nodes[at].children;
+            auto it = std::lower_bound(children.begin(), children.end(), std::make_pair(seg, len),
+                [](const std::pair<std::string, uint16_t>& child, const std::pair<const char*, size_t>& key){
+                    return child.first.compare(0, std::string::npos, key.first, key.second) < 0;
+                });
+            if(it != children.end() && it->first.size() == len && memcmp(it->first.data(), seg, len) == 0){return it->second;}
+            return -1;
+        }
+        const T* walk(uint32_t at, const char* p, const char* end, routeParams& params) const {
+            const char* seg;
+            size_t len;
+            const char* before = p;
+            if(!nextSegment(p, end, seg, len)){
+                if(_nodes[at].hasValue){return &_nodes[at].value;}
+                int32_t w = _nodes[at].wildcard;// "/static/*" also answers "/static"
+                if(w >= 0 && _nodes[w].hasValue){return capture("*", end, 0, params) ? &_nodes[w].value : nullptr;}
+                return nullptr;
+            }
+            int32_t next = literal(at, seg, len);
+            if(next >= 0){
+                const T* found = walk(next, p, end, params);
+                if(found != nullptr){return found;}
+            }
+            next = _nodes[at].param;
+            if(next >= 0 && capture(_nodes[at].paramName.c_str(), seg, len, params)){
+                const T* found = walk(next, p, end, params);
+                if(found != nullptr){return found;}
+                params.count--;// Backtrack
+            }
+            next = _nodes[at].wildcard;
+            if(next >= 0 && _nodes[next].hasValue){
+                while(before < end && *before == '/'){before++;}
+                if(capture("*", before, end - before, params)){return &_nodes[next].value;}
+            }
+            return nullptr;
+        }
+        static bool capture(const char* name, const char* value, size_t len, routeParams& params){
+            if(params.count >= WEB_ROUTE_PARAMS){return false;}
+            params.items[params.count++] = {name, value, len};
+            return true;
+        }
+    public:
+        routeTrie(){clear();}
+        void clear(){
+            _nodes.clear();
+            _nodes.emplace_back();
+            _built = false;
+        }
+        //Returns the slot for pattern, created empty on first use; nullptr for "*" before the last segment.
+        //The pointer is valid until the next insert()
+        T* insert(const char* pattern){
+            uint32_t at = 0;
+            const char* p = pattern;
+            const char* end = pattern + strlen(pattern);
+            const char* seg;
+            size_t len;
+            while(nextSegment(p, end, seg, len)){
+                int32_t next;
+                if(len == 1 && seg[0] == '*'){
+                    const char* rest = p;
+                    const char* s;
+                    size_t l;
+                    if(nextSegment(rest, end, s, l)){return nullptr;}// Wildcard must be last
+                    if(_nodes[at].wildcard < 0){
+                        _nodes[at].wildcard = _nodes.size();
+                        _nodes.emplace_back();
+                    }
+                    next = _nodes[at].wildcard;
+                } else if(len >= 2 && seg[0] == '{' && seg[len - 1] == '}'){
+                    if(_nodes[at].param < 0){
+                        _nodes[at].param = _nodes.size();
+                        _nodes[at].paramName.assign(seg + 1, len - 2);
+                        _nodes.emplace_back();
+                    }
+                    next = _nodes[at].param;// Same position, other name: the first name is kept
+                } else {
+                    next = -1;
+                    for(const auto& child : _nodes[at].children){// Not built yet - linear
+                        if(child.first.size() == len && memcmp(child.first.data(), seg, len) == 0){next = child.second; break;}
+                    }
+                    if(next < 0){
+                        next = _nodes.size();
+                        _nodes[at].children.emplace_back(std::string(seg, len), (uint16_t)next);
+                        _nodes.emplace_back();
+                    }
+                }
+                at = next;
+            }
+            _built = false;
+            _nodes[at].hasValue = true;
+            return &_nodes[at].value;
+        }
+        //Call once after the last insert() - match() needs sorted children
+        void build(){
+            for(auto& n : _nodes){std::sort(n.children.begin(), n.children.end());}
+            _built = true;
+        }
+        //params is reset; on success it holds the captured values
+        const T* match(const char* path, routeParams& params) const {
+            params.count = 0;
+            if(!_built){return nullptr;}
+            return walk(0, path, pathEnd(path), params);
+        }
+        size_t nodes() const {return _nodes.size();}
+};
+#endif // ROUTE_TRIE_H
@@ -0,0 +1,138 @@
+#include "serverMetrics.h"
+#include "esp_timer.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const uint32_t bucketUs[WEB_METRIC_BUCKETS] = {1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000};
+static const char* bucketLabel[WEB_METRIC_BUCKETS] = {"0.001", "0.0025", "0.005", "0.01", "0.025", "0.05", "0.1", "0.25", "0.5", "1", "2.5"};
+
+void serverMetrics::reset(size_t count){
+    _routes.reset(new routeMetrics[count + 1]);
+    _count = count + 1;
+    _used = 0;
+    _unmatched = &_routes[_used++];
+    _unmatched->route = "unmatched";
+    _unmatched->method = "ANY";
+    for(socketState& s : _sockets){s = socketState();}
+}
+serverMetrics::routeMetrics* serverMetrics::route(const char* pattern, httpd_method_t method){
+    if(_used >= _count){return _unmatched;}
+    routeMetrics* m = &_routes[_used++];
+    m->route = pattern;
+    m->method = methodName(method);
+    return m;
+}
+const char* serverMetrics::methodName(int method){
+    switch(method){
+        case HTTP_GET: return "GET";
+        case HTTP_POST: return "POST";
+        case HTTP_PUT: return "PUT";
+        case HTTP_DELETE: return "DELETE";
+        case HTTP_PATCH: return "PATCH";
+        case HTTP_HEAD: return "HEAD";
+        case HTTP_OPTIONS: return "OPTIONS";
+        default: return "OTHER";
+    }
+}
+void serverMetrics::start(httpd_req_t *req, routeMetrics* metrics){
+    socketState& s = state(httpd_req_to_sockfd(req));
+    s.metrics = (metrics != nullptr) ? metrics : _unmatched;
+    s.start = esp_timer_get_time();
+    s.status = 0;
+    s.bytesOut = 0;
+    s.active = true;
+    s.deferred = false;
+    s.metrics->bytesIn.fetch_add(req->content_len, std::memory_order_relaxed);
+}
+void serverMetrics::defer(httpd_req_t *req){state(httpd_req_to_sockfd(req)).deferred = true;}
+bool serverMetrics::deferred(httpd_req_t *req){return state(httpd_req_to_sockfd(req)).deferred;}
+void serverMetrics::finish(httpd_req_t *req){
+    socketState& s = state(httpd_req_to_sockfd(req));
+    if(!s.active || s.metrics == nullptr){return;}
+    s.active = false;
+    routeMetrics* m = s.metrics;
+    uint32_t us = (uint32_t)(esp_timer_get_time() - s.start);
+    int bucket = 0;
+    while(bucket < WEB_METRIC_BUCKETS && us > bucketUs[bucket]){bucket++;}
+    m->requests.fetch_add(1, std::memory_order_relaxed);
+    m->buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    m->latencyUs.fetch_add(us, std::memory_order_relaxed);
+    m->bytesOut.fetch_add(s.bytesOut, std::memory_order_relaxed);
+    int cls = (s.status >= 100 && s.status < 600) ? s.status / 100 - 1 : 4;// Nothing sent: counted as 5xx
+    m->status[cls].fetch_add(1, std::memory_order_relaxed);
+}
+void serverMetrics::opened(int fd){
+    state(fd) = socketState();
+    _open.fetch_add(1, std::memory_order_relaxed);
+    _opened.fetch_add(1, std::memory_order_relaxed);
+}
+void serverMetrics::closed(int fd){
+    _open.fetch_sub(1, std::memory_order_relaxed);
+    state(fd).active = false;
+}
+//Session send override: every byte httpd writes passes here
+void serverMetrics::sent(int fd, const char* data, int len){
+    if(len <= 0){return;}
+    _bytesOut.fetch_add(len, std::memory_order_relaxed);
+    socketState& s = state(fd);
+    if(!s.active){return;}// Push channels and keep-alive gaps
+    if(s.status == 0 && len >= 12 && memcmp(data, "HTTP/1.", 7) == 0){s.status = atoi(data + 9);}
+    s.bytesOut += len;
+}
+bool serverMetrics::label(responseWriter& out, const routeMetrics& m){
+    out.print("{route=\"");
+    for(const char* c = m.route.c_str(); *c; c++){// Label values escape \ and "
+        if(*c == '\\' || *c == '"'){out.write("\\", 1);}
+        out.write(c, 1);
+    }
+    return out.printf("\",method=\"%s\"", m.method);
+}
+//Prometheus text exposition format 0.0.4
+bool serverMetrics::write(responseWriter& out){
+    static const char* classes[5] = {"1xx", "2xx", "3xx", "4xx", "5xx"};
+    out.print("# HELP http_requests_total Requests by route, method and status class.\n# TYPE http_requests_total counter\n");
+    for(size_t i = 0; i < _used; i++){
+        for(int c = 0; c < 5; c++){
+            uint32_t n = _routes[i].status[c].load(std::memory_order_relaxed);
+            if(n == 0 && c != 1){continue;}// Always show 2xx so every route appears
+            out.print("http_requests_total");
+            label(out, _routes[i]);
+            out.printf(",code=\"%s\"} %lu\n", classes[c], (unsigned long)n);
+        }
+    }
+    out.print("# HELP http_request_body_bytes_total Request body bytes received.\n# TYPE http_request_body_bytes_total counter\n");
+    for(size_t i = 0; i < _used; i++){
+        out.print("http_request_body_bytes_total");
+        label(out, _routes[i]);
+        out.printf("} %lu\n", (unsigned long)_routes[i].bytesIn.load(std::memory_order_relaxed));
+    }
+    out.print("# HELP http_response_bytes_total Response bytes sent, headers included.\n# TYPE http_response_bytes_total counter\n");
+    for(size_t i = 0; i < _used; i++){
+        out.print("http_response_bytes_total");
+        label(out, _routes[i]);
+        out.printf("} %lu\n", (unsigned long)_routes[i].bytesOut.load(std::memory_order_relaxed));
+    }
+    out.print("# HELP http_request_duration_seconds Time from dispatch to the end of the response.\n# TYPE http_request_duration_seconds histogram\n");
+    for(size_t i = 0; i < _used; i++){
+        const routeMetrics& m = _routes[i];
+        uint32_t cumulative = 0;
+        for(int b = 0; b <= WEB_METRIC_BUCKETS; b++){
+            cumulative += m.buckets[b].load(std::memory_order_relaxed);
+            out.print("http_request_duration_seconds_bucket");
+            label(out, m);
+            out.printf(",le=\"%s\"} %lu\n", b < WEB_METRIC_BUCKETS ? bucketLabel[b] : "+Inf", (unsigned long)cumulative);
+        }
+        out.print("http_request_duration_seconds_sum");
+        label(out, m);
+        out.printf("} %.6f\n", m.latencyUs.load(std::memory_order_relaxed) / 1e6);
+        out.print("http_request_duration_seconds_count");
+        label(out, m);
+        out.printf("} %lu\n", (unsigned long)cumulative);
+    }
+    out.printf("# HELP http_sessions_open Open client sockets.\n# TYPE http_sessions_open gauge\nhttp_sessions_open %lu\n",
+               (unsigned long)_open.load(std::memory_order_relaxed));
+    out.printf("# HELP http_sessions_opened_total Client sockets accepted.\n# TYPE http_sessions_opened_total counter\nhttp_sessions_opened_total %lu\n",
+               (unsigned long)_opened.load(std::memory_order_relaxed));
+    return out.printf("# HELP http_sent_bytes_total All bytes sent, push channels included.\n# TYPE http_sent_bytes_total counter\nhttp_sent_bytes_total %lu\n",
+                      (unsigned long)_bytesOut.load(std::memory_order_relaxed));
+}
@@ -0,0 +1,79 @@
+#ifndef SERVER_METRICS_H
+#define SERVER_METRICS_H
+#include "esp_http_server.h"
+#include "sdkconfig.h"
+#include "responseWriter.h"
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <string>
+/*
+Request instrumentation for serverManager, exported in Prometheus text
+format.
+
+Every route gets one routeMetrics block, allocated once by begin(); after
+that, recording a request only touches relaxed 32-bit atomics - no lock,
+no allocation. Response status and bytes out are taken from the wire: a
+per-session send override counts every byte httpd writes and reads the
+status code from the "HTTP/1.1 NNN" line, so handlers need no changes.
+
+Per-socket state (start time, route, status) lives in a table indexed by
+socket number. A socket carries one request at a time, so the entry is
+only touched by the task handling that request.
+*/
+#ifndef WEB_METRIC_SOCKETS
+#define WEB_METRIC_SOCKETS CONFIG_LWIP_MAX_SOCKETS// lwIP socket numbers are contiguous, so fd % this is unique
+#endif
+#define WEB_METRIC_BUCKETS 11// Latency buckets below +Inf
+
+class serverMetrics{
+    public:
+        struct routeMetrics{
+            std::string route;// Pattern, e.g. "/api/pin/{name}"
+            const char* method = "GET";
+            std::atomic<uint32_t> requests{0};
+            std::atomic<uint32_t> bytesIn{0};// Request bodies
+            std::atomic<uint32_t> bytesOut{0};// Status line, headers and body
+            std::atomic<uint32_t> status[5] = {};// 1xx..5xx
+            std::atomic<uint32_t> latencyUs{0};// Sum - wraps after ~71 min of handler time, rate() treats that as a reset
+            std::atomic<uint32_t> buckets[WEB_METRIC_BUCKETS + 1] = {};// Not cumulative; +Inf last
+        };
+        serverMetrics() = default;
+        serverMetrics(const serverMetrics&) = delete;
+        //begin(): room for count routes plus the "unmatched" entry; invalidates earlier route() pointers
+        void reset(size_t count);
+        routeMetrics* route(const char* pattern, httpd_method_t method);
+        routeMetrics* unmatched(){return _unmatched;}
+        //httpd task: request matched (metrics = nullptr for 404/405)
+        void start(httpd_req_t *req, routeMetrics* metrics);
+        //Request handed to a worker - finish() comes from complete()
+        void defer(httpd_req_t *req);
+        bool deferred(httpd_req_t *req);
+        void finish(httpd_req_t *req);
+        //Session hooks
+        void opened(int fd);
+        void closed(int fd);
+        void sent(int fd, const char* data, int len);
+        bool write(responseWriter& out);
+        static const char* methodName(int method);
+    private:
+        struct socketState{
+            routeMetrics* metrics = nullptr;
+            int64_t start = 0;
+            uint16_t status = 0;
+            uint32_t bytesOut = 0;
+            bool active = false;
+            bool deferred = false;
+        };
+        std::unique_ptr<routeMetrics[]> _routes;
+        size_t _count = 0;
+        size_t _used = 0;
+        routeMetrics* _unmatched = nullptr;
+        socketState _sockets[WEB_METRIC_SOCKETS];
+        std::atomic<uint32_t> _open{0};
+        std::atomic<uint32_t> _opened{0};
+        std::atomic<uint32_t> _bytesOut{0};// Everything, including push channels
+        socketState& state(int fd){return _sockets[(unsigned)fd % WEB_METRIC_SOCKETS];}
+        static bool label(responseWriter& out, const routeMetrics& m);
+};
+#endif // SERVER_METRICS_H
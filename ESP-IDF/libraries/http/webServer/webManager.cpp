@@ -1,29 +1,36 @@
 #include "webManager.h"
 #include "../../Utils/Utils.h"
+#include "../../Utils/Logger.h"
 #include <cstring> // for strcmp
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>// close() in the session close_fn
+#include <errno.h>
+#include <sys/socket.h>// send() in the metrics send override, getpeername() for client limits
+#include <netinet/in.h>
+#include "esp_timer.h"
 
 #ifndef LOG_TAG
 #define LOG_TAG "webManager"
 #endif
 
 serverManager::serverManager(){
-    // Constructor implementation (if needed)
+    config = HTTPD_DEFAULT_CONFIG();
+    config.lru_purge_enable = true;
 }
 esp_err_t _handler(httpd_req_t *req) {
     serverManager::webData* ctx = (serverManager::webData*)req->user_ctx;
-    ESP_LOGI(LOG_TAG, "_handler called. ctx: %p", ctx);
+    DLOGD(LOG_TAG, "_handler called. ctx: %p", ctx);
     if(ctx && ctx->html != nullptr){
         const char* resp_str = ctx->html;
-        ESP_LOGI(LOG_TAG, "ctx->html: %s", resp_str ? resp_str : "<null>");
-        if(resp_str != nullptr && strcmp(resp_str, "") != 0){
-            ESP_LOGI(LOG_TAG, "Sending response: %s", resp_str);
-            esp_err_t send_ret = httpd_resp_send(req, resp_str, HTTPD_RESP_USE_STRLEN);
-            ESP_LOGI(LOG_TAG, "httpd_resp_send returned: %d", send_ret);
+        if(resp_str != nullptr && resp_str[0] != '\0'){
+            size_t length = (ctx->length > 0) ? ctx->length : strlen(resp_str);
+            esp_err_t send_ret = httpd_resp_send(req, resp_str, length);
+            DLOGI(LOG_TAG, "GET %s: %u bytes, httpd_resp_send returned: %d", req->uri, (unsigned)length, send_ret);
             return ESP_OK;
         }else{
-            ESP_LOGI(LOG_TAG, "Sending default empty HTML response");
             esp_err_t send_ret = httpd_resp_send(req, "<html><body><h1>Empty</h1><p>Content was not provided! :(</p></body></html>", HTTPD_RESP_USE_STRLEN);
-            ESP_LOGI(LOG_TAG, "httpd_resp_send returned: %d", send_ret);
+            DLOGI(LOG_TAG, "GET %s: default empty HTML response, httpd_resp_send returned: %d", req->uri, send_ret);
             return ESP_OK;
         }
     }else{ // Return 204 No Content - source not available
@@ -31,46 +38,233 @@ esp_err_t _handler(httpd_req_t *req) {
         const char* resp_status = ctx ? ctx->status : nullptr;
         if(resp_status == nullptr || strcmp(resp_status, "") == 0){resp_status = "204 No Content";}
         if(resp_errmsg == nullptr || strcmp(resp_errmsg, "") == 0){resp_errmsg = "Content not available";}
-        ESP_LOGI(LOG_TAG, "Sending 204 No Content. Status: %s, Error: %s", resp_status, resp_errmsg);
         httpd_resp_set_status(req, resp_status);
         esp_err_t send_ret = httpd_resp_send(req, NULL, 0);
-        ESP_LOGI(LOG_TAG, "httpd_resp_send (NULL) returned: %d", send_ret);
+        DLOGI(LOG_TAG, "GET %s: %s (%s), httpd_resp_send returned: %d", req->uri, resp_status, resp_errmsg, send_ret);
         // httpd_resp_send(req, NULL, 0);
         return ESP_OK;
     }
 }
+//-----------------------------------------
+//Body block pool
+//-----------------------------------------
+static char bodyBlocks[WEB_BODY_BLOCKS][WEB_BODY_BLOCK];
+static std::atomic<uint32_t> bodyBlocksUsed{0};
+static_assert(WEB_BODY_BLOCKS <= 32, "WEB_BODY_BLOCKS must fit the 32-bit pool mask");
+
+static int _acquireBlock(){
+    uint32_t used = bodyBlocksUsed.load(std::memory_order_relaxed);
+    while(true){
+        int slot = 0;
+        while(slot < WEB_BODY_BLOCKS && (used & (1u << slot))){slot++;}
+        if(slot == WEB_BODY_BLOCKS){return -1;}
+        if(bodyBlocksUsed.compare_exchange_weak(used, used | (1u << slot), std::memory_order_acquire)){return slot;}
+    }
+}
+static void _releaseBlock(int slot){bodyBlocksUsed.fetch_and(~(1u << slot), std::memory_order_release);}
+
+esp_err_t serverManager::readBody(httpd_req_t *req, size_t maxBody, bodyCallback callback, void* parameter){
+    size_t total = req->content_len;
+    if(total > maxBody){return ESP_ERR_INVALID_SIZE;}
+    int slot = _acquireBlock();
+    if(slot < 0){return ESP_ERR_NO_MEM;}
+    char* block = bodyBlocks[slot];
+    esp_err_t result = ESP_OK;
+    size_t offset = 0;
+    int retries = 0;
+    while(offset < total){
+        size_t want = total - offset;
+        if(want > WEB_BODY_BLOCK){want = WEB_BODY_BLOCK;}
+        int ret = httpd_req_recv(req, block, want);// May return less than requested
+        if(ret == HTTPD_SOCK_ERR_TIMEOUT){
+            if(++retries <= WEB_BODY_RETRIES){continue;}
+            result = ESP_ERR_TIMEOUT;
+            break;
+        }
+        if(ret <= 0){
+            result = ESP_FAIL;
+            break;
+        }
+        retries = 0;
+        if(callback != nullptr && !callback(block, ret, offset, parameter)){
+            result = ESP_ERR_INVALID_STATE;
+            break;
+        }
+        offset += ret;
+    }
+    if(result == ESP_OK && callback != nullptr && !callback(nullptr, 0, offset, parameter)){result = ESP_ERR_INVALID_STATE;}
+    _releaseBlock(slot);
+    return result;
+}
+//-----------------------------------------
+//Chunked responses
+//-----------------------------------------
+static bool _chunkSink(void* ctx, const char* data, size_t len){
+    return httpd_resp_send_chunk((httpd_req_t*)ctx, data, len) == ESP_OK;// len = 0 ends the response
+}
+struct templateCall{
+    const webTemplate* tpl;
+    void* ctx;
+};
+static void _renderTemplate(responseWriter& out, void* ctx){
+    templateCall* call = (templateCall*)ctx;
+    call->tpl->render(out, call->ctx);
+}
+esp_err_t serverManager::sendChunked(httpd_req_t *req, writeFn fill, void* ctx, const char* type){
+    int slot = _acquireBlock();// The scratch buffer comes from the body pool
+    if(slot < 0){
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_hdr(req, "Retry-After", "1");
+        httpd_resp_send(req, "Server busy", HTTPD_RESP_USE_STRLEN);
+        return ESP_ERR_NO_MEM;
+    }
+    httpd_resp_set_type(req, type);
+    responseWriter out(_chunkSink, req, bodyBlocks[slot], WEB_BODY_BLOCK);
+    fill(out, ctx);
+    bool ok = out.finish();
+    _releaseBlock(slot);
+    DLOGD(LOG_TAG, "%s: %u bytes chunked", req->uri, (unsigned)out.bytes());
+    return ok ? ESP_OK : ESP_FAIL;
+}
+esp_err_t serverManager::sendTemplate(httpd_req_t *req, const webTemplate& tpl, void* ctx, const char* type){
+    templateCall call = {&tpl, ctx};
+    return sendChunked(req, _renderTemplate, &call, type);
+}
+esp_err_t _templatehandler(httpd_req_t *req) {
+    const serverManager::templateData* data = (const serverManager::templateData*)req->user_ctx;
+    esp_err_t ret = serverManager::sendTemplate(req, *data->tpl, data->ctx, data->type);
+    return (ret == ESP_FAIL) ? ESP_FAIL : ESP_OK;
+}
+//-----------------------------------------
+//API option matching
+//-----------------------------------------
+/*
+Each option's rx is searched in every chunk as it arrives. The last
+WEB_RX_MAX - 1 bytes of the body are kept so a match split across two
+chunks is still found; the body itself is never stored.
+*/
+struct apiMatch{
+    serverManager::apiData* ctx;
+    uint32_t matched = 0;// Bit i: i-th option (map order) was found
+    char tail[WEB_RX_MAX];
+    size_t tailLen = 0;
+    jsonField json;// JSON mode only
+    explicit apiMatch(serverManager::apiData* api) : ctx(api), json(api->field ? api->field : ""){}
+};
+static bool _contains(const char* data, size_t len, const char* rx, size_t rxLen){
+    if(rxLen > len){return false;}
+    for(size_t i = 0; i + rxLen <= len; i++){
+        if(data[i] == rx[0] && memcmp(data + i, rx, rxLen) == 0){return true;}
+    }
+    return false;
+}
+static bool _matchBody(const char* data, size_t len, size_t offset, void* parameter){
+    apiMatch* match = (apiMatch*)parameter;
+    serverManager::apiData* ctx = match->ctx;
+    if(ctx->stream != nullptr && !ctx->stream(data, len, offset, ctx->streamParameter)){return false;}
+    if(data == nullptr){return true;}
+    if(offset == 0){DLOGD(LOG_TAG, "API %s: first chunk %u bytes", ctx->uri, (unsigned)len);}
+    if(ctx->field != nullptr){
+        match->json.feed(data, len);// Stops looking once the field is found
+        return true;
+    }
+    uint32_t bit = 1;
+    for(const auto& [key, option] : ctx->option){
+        if(bit == 0){break;}// More than 32 options
+        if(!(match->matched & bit)){
+            size_t rxLen = strlen(option.rx);
+            bool found = (rxLen == 0);
+            if(!found && rxLen < WEB_RX_MAX){
+                if(match->tailLen > 0){// Straddling the previous chunk
+                    char join[2 * WEB_RX_MAX];
+                    size_t head = (len < rxLen - 1) ? len : rxLen - 1;
+                    memcpy(join, match->tail, match->tailLen);
+                    memcpy(join + match->tailLen, data, head);
+                    found = _contains(join, match->tailLen + head, option.rx, rxLen);
+                }
+                if(!found){found = _contains(data, len, option.rx, rxLen);}
+            }
+            if(found){match->matched |= bit;}
+        }
+        bit <<= 1;
+    }
+    const size_t keep = WEB_RX_MAX - 1;
+    if(len >= keep){
+        memcpy(match->tail, data + len - keep, keep);
+        match->tailLen = keep;
+    } else {
+        size_t old = (match->tailLen + len > keep) ? keep - len : match->tailLen;
+        memmove(match->tail, match->tail + match->tailLen - old, old);
+        memcpy(match->tail + old, data, len);
+        match->tailLen = old + len;
+    }
+    return true;
+}
 esp_err_t _apihandler(httpd_req_t *req) {
     serverManager::apiData* ctx = (serverManager::apiData*)req->user_ctx;
     if(ctx && ctx!= nullptr){
-        char buf[100];
-        int ret, remaining = req->content_len;
-        if (remaining >= sizeof(buf)) {
-            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, ctx->error);
-            return ESP_FAIL;
-        }
-        ret = httpd_req_recv(req, buf, remaining);
-        if (ret <= 0) {
-            if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
-                // httpd_resp_send_408(req);
+        apiMatch match(ctx);
+        esp_err_t err = serverManager::readBody(req, ctx->maxBody, _matchBody, &match);
+        switch(err){
+            case ESP_OK:
+                break;
+            case ESP_ERR_INVALID_SIZE:
+                httpd_resp_set_status(req, "413 Content Too Large");
+                httpd_resp_send(req, ctx->error, HTTPD_RESP_USE_STRLEN);
+                return ESP_FAIL;// Close instead of draining the oversized body
+            case ESP_ERR_NO_MEM:
+                httpd_resp_set_status(req, "503 Service Unavailable");
+                httpd_resp_set_hdr(req, "Retry-After", "1");
+                httpd_resp_send(req, "Server busy", HTTPD_RESP_USE_STRLEN);
+                return ESP_OK;
+            case ESP_ERR_TIMEOUT:
                 httpd_resp_send_err(req, HTTPD_408_REQ_TIMEOUT, "Request Timeout");
+                return ESP_FAIL;
+            case ESP_ERR_INVALID_STATE:
+                httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid request body");
+                return ESP_FAIL;
+            default:
+                return ESP_FAIL;// Socket closed - nothing can be sent
+        }
+        DLOGI(LOG_TAG, "API %s: %u bytes", ctx->uri, (unsigned)req->content_len);
+        if(ctx->field != nullptr){
+            if(!match.json.found()){
+                httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing or invalid command field");
+                return ESP_FAIL;
             }
-            return ESP_FAIL;
+            const serverManager::apiOption* const* found = ctx->dispatch.find(match.json.value(), match.json.length());
+            if(found == nullptr){
+                httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown command");
+                return ESP_FAIL;
+            }
+            const serverManager::apiOption* option = *found;
+            if(option->async && option->handler != nullptr){
+                serverManager* self = (serverManager*)httpd_get_global_user_ctx(req->handle);
+                esp_err_t ret = self->_startAsync(req, option, nullptr, nullptr, nullptr);
+                if(ret != ESP_ERR_NOT_SUPPORTED){return ret;}
+            }
+            if(option->handler != nullptr){option->handler((void*)option->parameter);}
+            serverManager::sendResp(req,option->tx,option->type);
+            return ESP_OK;
         }
-        buf[ret] = '\0';
-        ESP_LOGI(LOG_TAG,"Dev: %s", ctx->uri);
-        ESP_LOGI(LOG_TAG,"Received data: %s", buf);
-        
+        uint32_t bit = 1;
         for(const auto& [key, option] : ctx->option){
-            if (strstr(buf, option.rx) != NULL) {// Match found, process the request
+            if(bit == 0){break;}
+            if(match.matched & bit){// Match found, process the request
+                if(option.async && option.handler != nullptr){
+                    serverManager* self = (serverManager*)httpd_get_global_user_ctx(req->handle);
+                    esp_err_t ret = self->_startAsync(req, &option, nullptr, nullptr, nullptr);
+                    if(ret != ESP_ERR_NOT_SUPPORTED){return ret;}
+                }
                 if(option.handler != nullptr){option.handler((void*)option.parameter);}// Call custom handler if provided
                 serverManager::sendResp(req,option.tx,option.type);
                 return ESP_OK;
             }
+            bit <<= 1;
         }
-   return ESP_OK;
-
-        //return ctx->handler(buf, req);// Call main handler if provided
-        //return ESP_OK;
+        httpd_resp_set_status(req, "204 No Content");// No option matched
+        httpd_resp_send(req, NULL, 0);
+        return ESP_OK;
     }else{ // Return 204 No Content - source not available
         const char* resp_errmsg = ctx ? ctx->error : nullptr;
         const char* resp_status = "204 No Content";
@@ -80,36 +274,443 @@ esp_err_t _apihandler(httpd_req_t *req) {
         return ESP_OK;
     }
 }
-void serverManager::addHTMLPath(std::string key,httpd_method_t method,webData data){collWeb[key] = {method, data};}
+//-----------------------------------------
+//Static assets
+//-----------------------------------------
+static bool _acceptsGzip(httpd_req_t *req){
+    char value[64];
+    if(httpd_req_get_hdr_value_len(req, "Accept-Encoding") == 0){return false;}
+    httpd_req_get_hdr_value_str(req, "Accept-Encoding", value, sizeof(value));// Truncated values still hold the start
+    value[sizeof(value) - 1] = '\0';
+    return strstr(value, "gzip") != nullptr;
+}
+//True when the client's cached copy is current - answers 304 and the caller is done
+static bool _notModified(httpd_req_t *req, const char* etag){
+    char value[64];
+    if(httpd_req_get_hdr_value_str(req, "If-None-Match", value, sizeof(value)) != ESP_OK){return false;}
+    if(strstr(value, etag) == nullptr && strcmp(value, "*") != 0){return false;}
+    httpd_resp_set_status(req, "304 Not Modified");
+    httpd_resp_send(req, NULL, 0);
+    return true;
+}
+static const char* _mimeType(const char* path){
+    static const struct {const char* ext; const char* type;} types[] = {
+        {".html", "text/html"}, {".htm", "text/html"}, {".css", "text/css"},
+        {".js", "application/javascript"}, {".json", "application/json"}, {".svg", "image/svg+xml"},
+        {".png", "image/png"}, {".jpg", "image/jpeg"}, {".jpeg", "image/jpeg"}, {".gif", "image/gif"},
+        {".ico", "image/x-icon"}, {".txt", "text/plain"}, {".wasm", "application/wasm"}, {".woff2", "font/woff2"}
+    };
+    const char* ext = strrchr(path, '.');
+    if(ext != nullptr){
+        for(const auto& t : types){
+            if(strcasecmp(ext, t.ext) == 0){return t.type;}
+        }
+    }
+    return "application/octet-stream";
+}
+//Flash is memory mapped, so chunks go to the socket straight from the partition
+static esp_err_t _sendFromFlash(httpd_req_t *req, const char* data, size_t size){
+    if(size <= WEB_ASSET_CHUNK){return httpd_resp_send(req, data, size);}
+    for(size_t offset = 0; offset < size; offset += WEB_ASSET_CHUNK){
+        size_t len = (size - offset < WEB_ASSET_CHUNK) ? size - offset : WEB_ASSET_CHUNK;
+        if(httpd_resp_send_chunk(req, data + offset, len) != ESP_OK){return ESP_FAIL;}// Client went away
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+esp_err_t _assethandler(httpd_req_t *req) {
+    const serverManager::staticAsset* asset = (const serverManager::staticAsset*)req->user_ctx;
+    httpd_resp_set_hdr(req, "ETag", asset->etag);
+    httpd_resp_set_hdr(req, "Cache-Control", asset->cacheControl);
+    if(asset->gzip){httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");}
+    if(_notModified(req, asset->etag)){
+        DLOGD(LOG_TAG, "GET %s: 304", req->uri);
+        return ESP_OK;
+    }
+    httpd_resp_set_type(req, asset->type);
+    if(asset->gzip){
+        if(!_acceptsGzip(req)){DLOGW(LOG_TAG, "GET %s: client does not accept gzip, sending it anyway", req->uri);}
+        httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    }
+    DLOGI(LOG_TAG, "GET %s: %u bytes from flash", req->uri, (unsigned)asset->size);
+    return _sendFromFlash(req, (const char*)asset->data, asset->size);
+}
+//The trie's "*" capture is the path below the prefix - empty segments and the query string are already gone
+esp_err_t _filehandler(httpd_req_t *req, const routeParams& params, void* parameter) {
+    const serverManager::staticDir* dir = (const serverManager::staticDir*)parameter;
+    size_t restLen = 0;
+    const char* rest = params.get("*", &restLen);
+    if(rest == nullptr){restLen = 0;}
+    for(size_t i = 0; i + 1 < restLen; i++){
+        if(rest[i] == '.' && rest[i + 1] == '.'){
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid path");
+            return ESP_FAIL;
+        }
+    }
+    char path[WEB_PATH_MAX];
+    int len = snprintf(path, sizeof(path), "%s/%.*s", dir->path.c_str(), (int)restLen, rest);
+    if(len <= 0 || len >= (int)sizeof(path) - 14){
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Path too long");
+        return ESP_FAIL;
+    }
+    if(path[len - 1] == '/'){len += snprintf(path + len, sizeof(path) - len, "index.html");}
+    const char* type = _mimeType(path);// From the name without .gz
+    struct stat st;
+    bool gzip = false;
+    if(_acceptsGzip(req)){
+        memcpy(path + len, ".gz", 4);
+        gzip = (stat(path, &st) == 0);
+        if(!gzip){path[len] = '\0';}
+    }
+    if(!gzip && stat(path, &st) != 0){
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "File not found");
+        return ESP_FAIL;
+    }
+    char etag[24];
+    snprintf(etag, sizeof(etag), "\"%lx-%lx\"", (unsigned long)st.st_size, (unsigned long)st.st_mtime);
+    httpd_resp_set_hdr(req, "ETag", etag);
+    httpd_resp_set_hdr(req, "Cache-Control", dir->cacheControl);
+    httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+    if(_notModified(req, etag)){return ESP_OK;}
+    FILE* file = fopen(path, "rb");
+    if(file == nullptr){
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Cannot open file");
+        return ESP_FAIL;
+    }
+    int slot = _acquireBlock();
+    if(slot < 0){
+        fclose(file);
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_hdr(req, "Retry-After", "1");
+        httpd_resp_send(req, "Server busy", HTTPD_RESP_USE_STRLEN);
+        return ESP_OK;
+    }
+    httpd_resp_set_type(req, type);
+    if(gzip){httpd_resp_set_hdr(req, "Content-Encoding", "gzip");}
+    esp_err_t result = ESP_OK;
+    size_t read;
+    while((read = fread(bodyBlocks[slot], 1, WEB_BODY_BLOCK, file)) > 0){
+        if(httpd_resp_send_chunk(req, bodyBlocks[slot], read) != ESP_OK){
+            result = ESP_FAIL;// Client went away
+            break;
+        }
+    }
+    fclose(file);
+    _releaseBlock(slot);
+    if(result == ESP_OK){result = httpd_resp_send_chunk(req, NULL, 0);}
+    DLOGI(LOG_TAG, "GET %s: %s, %u bytes%s", req->uri, path, (unsigned)st.st_size, gzip ? " (gzip)" : "");
+    return result;
+}
+//-----------------------------------------
+//Push channels
+//-----------------------------------------
+esp_err_t _wshandler(httpd_req_t *req) {
+    serverManager::pushRoute* route = (serverManager::pushRoute*)req->user_ctx;
+    if(req->method == HTTP_GET){// Handshake done by httpd - the socket is a WebSocket from now on
+        if(!route->channel.subscribe(httpd_req_to_sockfd(req), false)){return ESP_FAIL;}
+        DLOGI(LOG_TAG, "WS %s: client %d subscribed", req->uri, httpd_req_to_sockfd(req));
+        return ESP_OK;
+    }
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    httpd_ws_frame_t frame = {};
+    if(httpd_ws_recv_frame(req, &frame, 0) != ESP_OK){return ESP_FAIL;}
+    if(frame.len > 0){// Clients only listen - read and discard what they send
+        uint8_t buf[128];
+        if(frame.len > sizeof(buf)){return ESP_FAIL;}
+        frame.payload = buf;
+        if(httpd_ws_recv_frame(req, &frame, frame.len) != ESP_OK){return ESP_FAIL;}
+    }
+    if(frame.type == HTTPD_WS_TYPE_CLOSE){route->channel.unsubscribe(httpd_req_to_sockfd(req));}
+#endif
+    return ESP_OK;
+}
+esp_err_t _ssehandler(httpd_req_t *req) {
+    serverManager::pushRoute* route = (serverManager::pushRoute*)req->user_ctx;
+    int fd = httpd_req_to_sockfd(req);
+    if(!route->channel.subscribe(fd, true)){
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_send(req, "Too many clients", HTTPD_RESP_USE_STRLEN);
+        return ESP_OK;
+    }
+    // Raw header without Content-Length: the response stays open and events are written to the socket
+    static const char header[] = "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n"
+                                 "Cache-Control: no-cache\r\nConnection: keep-alive\r\n\r\nretry: 2000\n\n";
+    if(httpd_send(req, header, sizeof(header) - 1) < 0){
+        route->channel.unsubscribe(fd);
+        return ESP_FAIL;
+    }
+    DLOGI(LOG_TAG, "SSE %s: client %d subscribed", req->uri, fd);
+    return ESP_OK;
+}
+//-----------------------------------------
+//Session hooks
+//-----------------------------------------
+esp_err_t serverManager::_sessionOpen(httpd_handle_t hd, int sockfd){
+    serverManager* self = (serverManager*)httpd_get_global_user_ctx(hd);
+    if(self == nullptr){return ESP_OK;}
+    self->_sessions.fetch_add(1, std::memory_order_relaxed);
+    if(self->_clientLimit.enabled()){self->_peers[(unsigned)sockfd % CONFIG_LWIP_MAX_SOCKETS] = _peerKey(sockfd);}
+    if(self->_metrics){
+        self->_metrics->opened(sockfd);
+        httpd_sess_set_send_override(hd, sockfd, _metricSend);// Counts bytes and reads the status line
+    }
+    return ESP_OK;
+}
+void serverManager::_sessionClose(httpd_handle_t hd, int sockfd){
+    serverManager* self = (serverManager*)httpd_get_global_user_ctx(hd);
+    if(self != nullptr){
+        for(auto& [key, route] : self->collPush){route.channel.unsubscribe(sockfd);}
+        if(self->_metrics){self->_metrics->closed(sockfd);}
+        self->_sessions.fetch_sub(1, std::memory_order_relaxed);
+    }
+    close(sockfd);// close_fn replaces the default close
+}
+//Same as httpd's default send, plus the byte count
+int serverManager::_metricSend(httpd_handle_t hd, int sockfd, const char* buf, size_t len, int flags){
+    if(buf == nullptr){return HTTPD_SOCK_ERR_INVALID;}
+    int ret = send(sockfd, buf, len, flags);
+    if(ret < 0){return (errno == EAGAIN || errno == EINTR) ? HTTPD_SOCK_ERR_TIMEOUT : HTTPD_SOCK_ERR_FAIL;}
+    serverManager* self = (serverManager*)httpd_get_global_user_ctx(hd);
+    if(self != nullptr && self->_metrics){self->_metrics->sent(sockfd, buf, ret);}
+    return ret;
+}
+static void _noFree(void* ctx){}// global_user_ctx is the serverManager itself
+void serverManager::addPushPath(std::string key, const char* wsUri, const char* sseUri){
+    pushRoute& route = collPush[key];
+    route.wsUri = wsUri;
+    route.sseUri = sseUri;
+}
+bool serverManager::publish(std::string key, const char* payload, size_t len){
+    auto it = collPush.find(key);
+    if(it == collPush.end()){
+        ESP_LOGE(LOG_TAG, "Push channel not found: %s", key.c_str());
+        return false;
+    }
+    return it->second.channel.publish(payload, len);
+}
+pushChannel* serverManager::channel(std::string key){
+    auto it = collPush.find(key);
+    return (it != collPush.end()) ? &it->second.channel : nullptr;
+}
+void serverManager::addTemplatePath(std::string key, std::string uri, const webTemplate* tpl, void* ctx, const char* type){
+    if(tpl == nullptr){
+        ESP_LOGE(LOG_TAG, "Template %s is null", key.c_str());
+        return;
+    }
+    if(tpl->unbound() > 0){ESP_LOGW(LOG_TAG, "Template %s: %u fields without bind() render empty", key.c_str(), (unsigned)tpl->unbound());}
+    templateData page;
+    page.uri = uri;
+    page.tpl = tpl;
+    page.ctx = ctx;
+    page.type = type;
+    collTemplate[key] = page;
+}
+void serverManager::addHTMLPath(std::string key,httpd_method_t method,webData data){
+    data.length = (data.html != nullptr) ? strlen(data.html) : 0;
+    collWeb[key] = {method, data};
+}
+void serverManager::addAsset(std::string key, staticAsset asset){
+    if(asset.data == nullptr){
+        ESP_LOGE(LOG_TAG, "Asset %s has no data", key.c_str());
+        return;
+    }
+    snprintf(asset.etag, sizeof(asset.etag), "\"%08lx\"", (unsigned long)jsonHash((const char*)asset.data, asset.size));// Strong ETag: changes with the content
+    collAsset[key] = asset;
+}
+void serverManager::addAsset(std::string key, const char* uri, const uint8_t* start, const uint8_t* end, const char* type, bool gzip){
+    staticAsset asset;
+    asset.uri = uri;
+    asset.data = start;
+    asset.size = end - start;
+    asset.type = type;
+    asset.gzip = gzip;
+    addAsset(key, asset);
+}
 void serverManager::addAPIPath(std::string key, apiData apiData){
+    if(apiData.field == nullptr && apiData.option.size() > 32){ESP_LOGW(LOG_TAG, "API %s: only the first 32 options are matched", apiData.uri);}
+    for(const auto& [name, option] : apiData.option){
+        if(apiData.field != nullptr && strlen(option.rx) >= WEB_JSON_VALUE){ESP_LOGW(LOG_TAG, "API %s: rx of option %s is longer than WEB_JSON_VALUE-1 and never matches", apiData.uri, name.c_str());}
+        if(apiData.field == nullptr && strlen(option.rx) >= WEB_RX_MAX){ESP_LOGW(LOG_TAG, "API %s: rx of option %s is longer than WEB_RX_MAX-1 and never matches", apiData.uri, name.c_str());}
+    }
     collApi[key] = apiData;
 }
+void serverManager::_addTarget(const char* pattern, routeTarget target){
+    if(_metrics){target.metrics = _metrics->route(pattern, target.method);}
+    auto limit = collLimit.find(pattern);
+    if(limit != collLimit.end()){
+        target.lane = limit->second.lane;
+        if(limit->second.limit.enabled()){
+            target.limit = &limit->second.limit;
+            target.bucket = &limit->second.bucket;
+        }
+    }
+    routeSlot* slot = routes.insert(pattern);
+    if(slot == nullptr){
+        ESP_LOGE(LOG_TAG, "Route %s: '*' must be the last segment", pattern);
+        return;
+    }
+    for(routeTarget& existing : slot->targets){
+        if(existing.method != target.method){continue;}
+        ESP_LOGW(LOG_TAG, "Route %s registered twice for method %d, the last one answers", pattern, (int)target.method);
+        existing = target;
+        return;
+    }
+    slot->targets.push_back(target);
+}
+//One wildcard handler per method: the trie picks the route, httpd only sees a few handler slots
+esp_err_t serverManager::_route(httpd_req_t *req){
+    serverManager* self = (serverManager*)req->user_ctx;
+    routeParams params;
+    const routeSlot* slot = self->routes.match(req->uri, params);
+    const routeTarget* target = nullptr;
+    if(slot != nullptr){
+        for(const routeTarget& t : slot->targets){
+            if(t.method == (httpd_method_t)req->method){target = &t; break;}
+        }
+    }
+    serverMetrics* metrics = self->_metrics.get();
+    if(metrics != nullptr){metrics->start(req, (target != nullptr) ? target->metrics : nullptr);}
+    int64_t now = esp_timer_get_time();
+    esp_err_t ret = ESP_ERR_NOT_SUPPORTED;
+    if(!self->_admit(req, target, now)){
+        ret = ESP_OK;// 429 or 503 already sent
+    } else if(slot == nullptr){
+        DLOGD(LOG_TAG, "%s: no route", req->uri);
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Not found");
+        ret = ESP_FAIL;
+    } else if(target == nullptr){
+        httpd_resp_set_status(req, "405 Method Not Allowed");
+        httpd_resp_send(req, "Method not allowed", HTTPD_RESP_USE_STRLEN);
+        ret = ESP_OK;
+    } else {
+        if(target->async){ret = self->_startAsync(req, nullptr, target->route, target->ctx, &params);}
+        if(ret == ESP_ERR_NOT_SUPPORTED){
+            if(target->route != nullptr){
+                ret = target->route(req, params, target->ctx);
+            } else {
+                req->user_ctx = target->ctx;// What httpd would have passed with one handler per route
+                ret = target->handler(req);
+            }
+        }
+    }
+    if(metrics != nullptr && !metrics->deferred(req)){metrics->finish(req);}// Async requests finish in complete()
+    self->_busy(now, esp_timer_get_time());
+    return ret;
+}
+void serverManager::addRoute(std::string key, httpd_method_t method, std::string pattern, routeHandler handler, void* parameter, bool async){
+    if(handler == nullptr){
+        ESP_LOGE(LOG_TAG, "Route %s has no handler", key.c_str());
+        return;
+    }
+    routeData route;
+    route.method = method;
+    route.pattern = pattern;
+    route.handler = handler;
+    route.parameter = parameter;
+    route.async = async;
+    collRoute[key] = route;
+}
 httpd_handle_t serverManager::begin(){
+    if(server != NULL){
+        ESP_LOGW(LOG_TAG, "Server already running, call stop() first");
+        return server;
+    }
+    // Compile every route into the trie - the trie copies the segments, so no URI string has to outlive begin()
+    routes.clear();
+    for(auto& [pattern, limit] : collLimit){
+        limit.limit.set(limit.perSecond, limit.burst);
+        limit.bucket = tokenBucket();
+    }
+    _clients.clear();
+    _windowStart = 0;
+    _busyUs = 0;
+    _busyPercent = 0;
+    if(_metrics){_metrics->reset(collWeb.size() + collApi.size() + collAsset.size() + collStatic.size() + collTemplate.size() + collRoute.size() + 1);}
+    for(auto& [key, webDta] : collWeb){_addTarget(webDta.data.uri, {webDta.method, _handler, nullptr, (void*)&webDta.data, false});}
+    for(auto& [key, apiDta] : collApi){
+        if(apiDta.field != nullptr){// Hash every command once, lookups are then a binary search
+            apiDta.dispatch.clear();
+            for(const auto& [name, option] : apiDta.option){apiDta.dispatch.add(option.rx, &option);}
+            apiDta.dispatch.build();
+        }
+        std::string fullUri = "/" + std::string(apiDta.uri);
+        _addTarget(fullUri.c_str(), {apiDta.method, _apihandler, nullptr, (void*)&apiDta, false});
+    }
+    for(auto& [key, asset] : collAsset){_addTarget(asset.uri, {HTTP_GET, _assethandler, nullptr, (void*)&asset, false, nullptr, WEB_LANE_BULK});}
+    for(auto& [key, dir] : collStatic){_addTarget((dir.uri + "/*").c_str(), {HTTP_GET, nullptr, _filehandler, (void*)&dir, false, nullptr, WEB_LANE_BULK});}
+    for(auto& [key, page] : collTemplate){_addTarget(page.uri.c_str(), {HTTP_GET, _templatehandler, nullptr, (void*)&page, false});}
+    for(auto& [key, route] : collRoute){_addTarget(route.pattern.c_str(), {route.method, nullptr, route.handler, route.parameter, route.async});}
+    if(_metrics){_addTarget(_metricsUri.c_str(), {HTTP_GET, _metricshandler, nullptr, (void*)this, false});}
+    routes.build();
+    std::vector<httpd_method_t> methods;
+    auto useMethod = [&methods](httpd_method_t method){
+        if(std::find(methods.begin(), methods.end(), method) == methods.end()){methods.push_back(method);}
+    };
+    for(const auto& [key, webDta] : collWeb){useMethod(webDta.method);}
+    for(const auto& [key, apiDta] : collApi){useMethod(apiDta.method);}
+    if(!collAsset.empty() || !collStatic.empty() || !collTemplate.empty() || _metrics){useMethod(HTTP_GET);}
+    for(const auto& [key, route] : collRoute){useMethod(route.method);}
+
     httpd_handle_t server_instance = NULL;
-    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
-    config.lru_purge_enable = true;
+    httpd_config_t config = this->config;// Routes and push hooks below do not change the user's settings
+    config.uri_match_fn = httpd_uri_match_wildcard;// For the "/*" dispatch handlers
+    size_t handlers = methods.size();
+    for(const auto& [key, route] : collPush){handlers += (route.wsUri != nullptr) + (route.sseUri != nullptr);}
+    if(handlers > config.max_uri_handlers){config.max_uri_handlers = handlers;}
+    config.global_user_ctx = this;// Async API options find their serverManager through it
+    config.global_user_ctx_free_fn = _noFree;
+    if(!collPush.empty() || _metrics || _clientLimit.enabled() || _shedFree > 0){// Push clients must be forgotten when their socket closes
+        config.open_fn = _sessionOpen;
+        config.close_fn = _sessionClose;
+    }
+    _maxSessions = config.max_open_sockets;
+    _sessions.store(0, std::memory_order_relaxed);
+    if(_asyncLimit > 0 && _asyncLimit >= config.max_open_sockets){
+        ESP_LOGW(LOG_TAG, "%u async requests can hold all %u sockets, new clients will wait", _asyncLimit, config.max_open_sockets);
+    }
     // Start the httpd server
     if (httpd_start(&server_instance, &config) == ESP_OK) {
-        // Register HTML paths
-        for(const auto& [key, webDta] : collWeb){
-            httpd_uri_t uri_handler = {
-                .uri       = webDta.data.uri,
-                .method    = webDta.method,
-                .handler   = _handler,
-                .user_ctx  = (void*)&(collWeb[key].data)
-            };
-            httpd_register_uri_handler(server_instance, &uri_handler);
+        // Push routes first - httpd tries handlers in registration order and "/*" matches everything
+        for(auto& [key, route] : collPush){
+            route.channel.attach(server_instance);
+            if(route.wsUri != nullptr){
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+                httpd_uri_t uri_handler = {};
+                uri_handler.uri = route.wsUri;
+                uri_handler.method = HTTP_GET;
+                uri_handler.handler = _wshandler;
+                uri_handler.user_ctx = (void*)&route;
+                uri_handler.is_websocket = true;
+                httpd_register_uri_handler(server_instance, &uri_handler);
+#else
+                ESP_LOGW(LOG_TAG, "Push %s: enable CONFIG_HTTPD_WS_SUPPORT for WebSocket, use SSE meanwhile", key.c_str());
+#endif
+            }
+            if(route.sseUri != nullptr){
+                httpd_uri_t uri_handler = {
+                    .uri       = route.sseUri,
+                    .method    = HTTP_GET,
+                    .handler   = _ssehandler,
+                    .user_ctx  = (void*)&route
+                };
+                httpd_register_uri_handler(server_instance, &uri_handler);
+            }
         }
-        for(const auto& [key, apiDta] : collApi){
-            std::string fullUri = "/" + std::string(apiDta.uri);
+        for(httpd_method_t method : methods){
             httpd_uri_t uri_handler = {
-                .uri       = fullUri.c_str(),
-                .method    = apiDta.method,
-                .handler   = _apihandler,
-                .user_ctx  = (void*)&(collApi[key])
+                .uri       = "/*",
+                .method    = method,
+                .handler   = _route,
+                .user_ctx  = (void*)this
             };
             httpd_register_uri_handler(server_instance, &uri_handler);
         }
+        ESP_LOGI(LOG_TAG, "Server on port %u: %u sockets, stack %u, priority %u, core %d, timeout %us",
+                 config.server_port, config.max_open_sockets, (unsigned)config.stack_size,
+                 (unsigned)config.task_priority, (int)config.core_id, config.recv_wait_timeout);
+        ESP_LOGI(LOG_TAG, "%u routes in %u trie nodes, %u httpd handlers",
+                 (unsigned)(collWeb.size() + collApi.size() + collAsset.size() + collStatic.size() + collTemplate.size() + collRoute.size() + (_metrics ? 1 : 0)),
+                 (unsigned)routes.nodes(), (unsigned)handlers);
+        server = server_instance;
         return server_instance;
     }
     ESP_LOGI("ERRWEB", "Error starting HTTP server!");
@@ -120,11 +721,223 @@ void serverManager::sendResp(httpd_req_t *req,const char* resp,const char* type)
     httpd_resp_send(req, resp, HTTPD_RESP_USE_STRLEN);
 }
 void serverManager::addStaticPath(std::string path, std::string filePath){
-    // Implementation to add static file path
+    while(!path.empty() && path.back() == '/'){path.pop_back();}// "/static/" and "/static" are the same prefix
+    while(!filePath.empty() && filePath.back() == '/'){filePath.pop_back();}
+    staticDir dir;
+    dir.uri = path;
+    dir.path = filePath;
+    collStatic[path] = dir;
 }
 
-void serverManager::stop(){
-    // Implementation to stop the server
+//-----------------------------------------
+//Async requests
+//-----------------------------------------
+/*
+The httpd task reads the body and matches the route as usual, then hands
+a copy of the request (httpd_req_async_handler_begin) to the worker pool
+and goes back to serving other sockets. The slot holds the copy until
+complete(); the socket of that client stays busy until then.
+*/
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 2, 0)
+#define WEB_ASYNC_SUPPORTED 1
+#else
+#define WEB_ASYNC_SUPPORTED 0
+#endif
+static constexpr uint32_t ASYNC_STOPPING = 1u << 31;// Set in _asyncUsed by stop(), so claiming a slot and stopping cannot interleave
+static_assert(WEB_ASYNC_MAX <= 31, "WEB_ASYNC_MAX must fit the slot mask below the stopping bit");
+
+bool serverManager::setWorkers(Utils::taskManager* tasks, uint8_t maxInFlight){
+#if WEB_ASYNC_SUPPORTED
+    if(maxInFlight > WEB_ASYNC_MAX){
+        ESP_LOGW(LOG_TAG, "setWorkers: %u requests in flight limited to WEB_ASYNC_MAX (%d)", maxInFlight, WEB_ASYNC_MAX);
+        maxInFlight = WEB_ASYNC_MAX;
+    }
+    _workers = tasks;
+    _asyncLimit = (tasks != nullptr) ? maxInFlight : 0;
+    return true;
+#else
+    ESP_LOGW(LOG_TAG, "Async requests need ESP-IDF 5.2 or later, async routes run on the httpd task");
+    return false;
+#endif
+}
+serverManager::asyncSlot* serverManager::_acquireAsync(){
+    uint32_t used = _asyncUsed.load(std::memory_order_relaxed);
+    while(true){
+        int slot = 0;
+        while(slot < _asyncLimit && (used & (1u << slot))){slot++;}
+        if(slot >= _asyncLimit || (used & ASYNC_STOPPING)){return nullptr;}
+        if(_asyncUsed.compare_exchange_weak(used, used | (1u << slot), std::memory_order_acquire)){
+            uint8_t inFlight = __builtin_popcount(used) + 1;
+            uint8_t peak = _asyncPeak.load(std::memory_order_relaxed);
+            while(inFlight > peak && !_asyncPeak.compare_exchange_weak(peak, inFlight, std::memory_order_relaxed)){}
+            return &_async[slot];
+        }
+    }
+}
+void serverManager::_releaseAsync(asyncSlot* slot){
+    slot->req = nullptr;
+    _asyncUsed.fetch_and(~(1u << (slot - _async)), std::memory_order_release);
+}
+//ESP_ERR_NOT_SUPPORTED: no pool - the caller runs the handler itself
+esp_err_t serverManager::_startAsync(httpd_req_t *req, const void* option, esp_err_t (*route)(httpd_req_t*, const routeParams&, void*), void* parameter, const routeParams* params){
+#if WEB_ASYNC_SUPPORTED
+    if(_workers == nullptr || _asyncLimit == 0){return ESP_ERR_NOT_SUPPORTED;}
+    asyncSlot* slot = _acquireAsync();
+    if(slot == nullptr){
+        _asyncRejected.fetch_add(1, std::memory_order_relaxed);
+        if(_asyncUsed.load(std::memory_order_relaxed) & ASYNC_STOPPING){
+            DLOGW(LOG_TAG, "%s: server stopping, answering 503", req->uri);
+        } else {
+            DLOGW(LOG_TAG, "%s: %u async requests in flight, answering 503", req->uri, _asyncLimit);
+        }
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_hdr(req, "Retry-After", "1");
+        httpd_resp_send(req, "Server busy", HTTPD_RESP_USE_STRLEN);
+        return ESP_OK;
+    }
+    httpd_req_t* copy = nullptr;
+    if(httpd_req_async_handler_begin(req, &copy) != ESP_OK){
+        _releaseAsync(slot);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+    slot->self = this;
+    slot->req = copy;
+    slot->option = option;
+    slot->route = route;
+    slot->parameter = parameter;
+    slot->params.count = 0;
+    if(params != nullptr){// Values point into req->uri - move them to the copy's uri
+        slot->params = *params;
+        for(size_t i = 0; i < params->count; i++){slot->params.items[i].value = copy->uri + (params->items[i].value - req->uri);}
+    }
+    copy->user_ctx = slot;// complete() finds the slot through it
+    if(_metrics){_metrics->defer(req);}// Before submit - the worker may complete before we return
+    if(!_workers->submit(_asyncWork, slot).valid()){
+        _asyncRejected.fetch_add(1, std::memory_order_relaxed);
+        httpd_resp_set_status(copy, "503 Service Unavailable");
+        httpd_resp_set_hdr(copy, "Retry-After", "1");
+        httpd_resp_send(copy, "Server busy", HTTPD_RESP_USE_STRLEN);
+        if(_metrics){_metrics->finish(copy);}
+        httpd_req_async_handler_complete(copy);
+        _releaseAsync(slot);
+        return ESP_OK;
+    }
+    _asyncAccepted.fetch_add(1, std::memory_order_relaxed);
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+//Worker task
+void serverManager::_asyncWork(void* arg){
+    asyncSlot* slot = (asyncSlot*)arg;
+    httpd_req_t* req = slot->req;
+    if(slot->option != nullptr){
+        const apiOption* option = (const apiOption*)slot->option;
+        option->handler((void*)option->parameter);
+        sendResp(req, option->tx, option->type);
+        complete(req);
+        return;
+    }
+    esp_err_t ret = slot->route(req, slot->params, slot->parameter);
+    if(ret == ESP_ERR_NOT_FINISHED){return;}// The handler calls complete() later
+    if(ret != ESP_OK){httpd_sess_trigger_close(req->handle, httpd_req_to_sockfd(req));}// Same as a failing synchronous handler
+    complete(req);
+}
+void serverManager::complete(httpd_req_t *req){
+#if WEB_ASYNC_SUPPORTED
+    asyncSlot* slot = (asyncSlot*)req->user_ctx;
+    serverManager* self = slot->self;
+    if(self->_metrics){self->_metrics->finish(req);}// Before the socket takes its next request
+    httpd_req_async_handler_complete(req);
+    self->_asyncCompleted.fetch_add(1, std::memory_order_relaxed);
+    self->_releaseAsync(slot);
+#endif
+}
+serverManager::asyncStats serverManager::getAsyncStats() const {
+    return {_asyncAccepted.load(std::memory_order_relaxed), _asyncRejected.load(std::memory_order_relaxed),
+            _asyncCompleted.load(std::memory_order_relaxed), (uint8_t)__builtin_popcount(_asyncUsed.load(std::memory_order_relaxed) & ~ASYNC_STOPPING),
+            _asyncPeak.load(std::memory_order_relaxed)};
+}
+//-----------------------------------------
+//Tuning
+//-----------------------------------------
+static void _configurable(httpd_handle_t server, const char* setting){
+    if(server != NULL){ESP_LOGW(LOG_TAG, "%s applies on the next begin(), the server is running", setting);}
+}
+void serverManager::setPort(uint16_t port){
+    _configurable(server, "setPort");
+    config.server_port = port;
+}
+void serverManager::setMaxConnections(uint16_t maxConn){
+    _configurable(server, "setMaxConnections");
+    if(maxConn > CONFIG_LWIP_MAX_SOCKETS - 3){// httpd_start() refuses more: it needs 3 sockets of its own
+        ESP_LOGW(LOG_TAG, "setMaxConnections(%u) limited to %d by CONFIG_LWIP_MAX_SOCKETS", maxConn, CONFIG_LWIP_MAX_SOCKETS - 3);
+        maxConn = CONFIG_LWIP_MAX_SOCKETS - 3;
+    }
+    if(maxConn == 0){maxConn = 1;}
+    config.max_open_sockets = maxConn;
+}
+void serverManager::setBacklog(uint16_t backlog){
+    _configurable(server, "setBacklog");
+    config.backlog_conn = backlog;
+}
+void serverManager::setTimeout(uint32_t timeout_ms){
+    _configurable(server, "setTimeout");
+    uint16_t seconds = (timeout_ms + 999) / 1000;// httpd counts whole seconds
+    if(seconds == 0){seconds = 1;}
+    config.recv_wait_timeout = seconds;
+    config.send_wait_timeout = seconds;
+}
+void serverManager::setStackSize(size_t stackSize){
+    _configurable(server, "setStackSize");
+    config.stack_size = stackSize;
+}
+void serverManager::setTaskPriority(UBaseType_t priority){
+    _configurable(server, "setTaskPriority");
+    if(priority >= configMAX_PRIORITIES){priority = configMAX_PRIORITIES - 1;}
+    config.task_priority = priority;
+}
+void serverManager::setCoreID(int coreID){
+    _configurable(server, "setCoreID");
+    config.core_id = (coreID >= 0 && coreID < portNUM_PROCESSORS) ? coreID : tskNO_AFFINITY;
+}
+void serverManager::setLruPurge(bool enable){
+    _configurable(server, "setLruPurge");
+    config.lru_purge_enable = enable;
+}
+void serverManager::setKeepAlive(bool enable, int idle_s, int interval_s, int count){
+    _configurable(server, "setKeepAlive");
+    config.keep_alive_enable = enable;
+    config.keep_alive_idle = idle_s;
+    config.keep_alive_interval = interval_s;
+    config.keep_alive_count = count;
+}
+httpd_config_t& serverManager::getConfig(){
+    return config;
+}
+bool serverManager::isRunning() const {
+    return server != NULL;
+}
+//Async slots hold request copies that httpd_stop() would free under the workers, so they must drain first
+esp_err_t serverManager::stop(TickType_t timeout){
+    if(server == NULL){return ESP_OK;}
+    _asyncUsed.fetch_or(ASYNC_STOPPING, std::memory_order_acq_rel);// From here no slot can be claimed
+    TickType_t start = xTaskGetTickCount();
+    while(_asyncUsed.load(std::memory_order_acquire) != ASYNC_STOPPING){
+        if(timeout != portMAX_DELAY && xTaskGetTickCount() - start >= timeout){
+            _asyncUsed.fetch_and(~ASYNC_STOPPING, std::memory_order_release);
+            ESP_LOGE(LOG_TAG, "Not stopping: %d async requests still in flight", __builtin_popcount(_asyncUsed.load() & ~ASYNC_STOPPING));
+            return ESP_ERR_TIMEOUT;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    for(auto& [key, route] : collPush){route.channel.attach(nullptr);}// No more queued pumps or retries
+    httpd_stop(server);// Closes every session; close_fn removes push clients
+    server = NULL;
+    _asyncUsed.fetch_and(~ASYNC_STOPPING, std::memory_order_release);
+    return ESP_OK;
 }
 /*void serverManager::_startRootFavicon(){
     httpd_register_uri_handler(server_instance, &root);
@@ -132,4 +945,137 @@ void serverManager::stop(){
 serverManager::~serverManager(){
     // Destructor implementation (if needed)
     stop();
-}
\ No newline at end of file
+}
+//-----------------------------------------
+//Metrics
+//-----------------------------------------
+void serverManager::enableMetrics(const char* uri){
+    _configurable(server, "enableMetrics");
+    if(!_metrics){_metrics.reset(new serverMetrics());}
+    _metricsUri = (uri != nullptr && uri[0] != '\0') ? uri : "/metrics";
+}
+esp_err_t serverManager::_metricshandler(httpd_req_t *req){
+    writeFn fill = [](responseWriter& out, void* ctx){
+        serverManager* self = (serverManager*)ctx;
+        self->_metrics->write(out);
+        asyncStats stats = self->getAsyncStats();
+        out.printf("# HELP http_async_requests_total Requests handed to the worker pool, by outcome.\n# TYPE http_async_requests_total counter\n"
+                   "http_async_requests_total{outcome=\"accepted\"} %lu\nhttp_async_requests_total{outcome=\"rejected\"} %lu\n"
+                   "http_async_requests_total{outcome=\"completed\"} %lu\n",
+                   (unsigned long)stats.accepted, (unsigned long)stats.rejected, (unsigned long)stats.completed);
+        out.printf("# HELP http_async_in_flight Requests on the worker pool.\n# TYPE http_async_in_flight gauge\nhttp_async_in_flight %u\n",
+                   (unsigned)stats.inFlight);
+        limitStats limits = self->getLimitStats();
+        out.printf("# HELP http_admission_rejected_total Requests refused before their handler ran, by reason.\n# TYPE http_admission_rejected_total counter\n"
+                   "http_admission_rejected_total{reason=\"client\"} %lu\nhttp_admission_rejected_total{reason=\"route\"} %lu\n"
+                   "http_admission_rejected_total{reason=\"shed\"} %lu\n",
+                   (unsigned long)limits.clientLimited, (unsigned long)limits.routeLimited, (unsigned long)limits.shed);
+        out.printf("# HELP http_server_busy_ratio Share of the last window the httpd task spent in handlers.\n# TYPE http_server_busy_ratio gauge\nhttp_server_busy_ratio %.2f\n",
+                   limits.busyPercent / 100.0);
+    };
+    esp_err_t ret = sendChunked(req, fill, req->user_ctx, "text/plain; version=0.0.4");
+    return (ret == ESP_FAIL) ? ESP_FAIL : ESP_OK;// ESP_ERR_NO_MEM already answered 503, keep the socket
+}
+//-----------------------------------------
+//Admission control
+//-----------------------------------------
+/*
+Runs on the httpd task before the handler, so a rejected request costs
+one bucket update and a short response - no body is read and no worker
+is used. Bulk requests are shed first, control routes are never shed and
+skip the per-client bucket, so a page full of images cannot starve the
+buttons on it.
+*/
+//IPv4 address, or a hash of the IPv6 one; IPv4-mapped addresses give the IPv4 key
+uint32_t serverManager::_peerKey(int sockfd){
+    struct sockaddr_storage addr = {};
+    socklen_t len = sizeof(addr);
+    if(getpeername(sockfd, (struct sockaddr*)&addr, &len) != 0){return 0;}
+    if(addr.ss_family == AF_INET){return ((struct sockaddr_in*)&addr)->sin_addr.s_addr;}
+    if(addr.ss_family == AF_INET6){
+        uint32_t words[4];
+        memcpy(words, &((struct sockaddr_in6*)&addr)->sin6_addr, sizeof(words));
+        if(words[0] == 0 && words[1] == 0 && words[2] == htonl(0xFFFF)){return words[3];}
+        uint32_t key = 2166136261u;
+        for(uint32_t word : words){key = (key ^ word) * 16777619u;}
+        return key;
+    }
+    return 0;
+}
+static void _tooMany(httpd_req_t *req, uint32_t retryMs){
+    char retry[12];
+    snprintf(retry, sizeof(retry), "%lu", (unsigned long)((retryMs + 999) / 1000));
+    httpd_resp_set_status(req, "429 Too Many Requests");
+    httpd_resp_set_hdr(req, "Retry-After", retry);
+    httpd_resp_send(req, "Too many requests", HTTPD_RESP_USE_STRLEN);
+}
+bool serverManager::_admit(httpd_req_t *req, const routeTarget* target, int64_t now){
+    webLane lane = (target != nullptr) ? target->lane : WEB_LANE_NORMAL;
+    if(lane == WEB_LANE_BULK && (_shedBusy > 0 || _shedFree > 0)){
+        bool busy = _shedBusy > 0 && _busyPercent > _shedBusy && now - _windowStart < 2 * WEB_BUSY_WINDOW_MS * 1000;// Stale after an idle gap
+        bool full = _shedFree > 0 && _maxSessions - _sessions.load(std::memory_order_relaxed) < _shedFree;
+        if(busy || full){
+            _shed.fetch_add(1, std::memory_order_relaxed);
+            DLOGD(LOG_TAG, "%s: shed, httpd %u%% busy, %u sessions", req->uri, _busyPercent, _sessions.load(std::memory_order_relaxed));
+            httpd_resp_set_status(req, "503 Service Unavailable");
+            httpd_resp_set_hdr(req, "Retry-After", "1");
+            httpd_resp_send(req, "Server busy", HTTPD_RESP_USE_STRLEN);
+            if(full){httpd_sess_trigger_close(req->handle, httpd_req_to_sockfd(req));}// Frees the socket for control clients
+            return false;
+        }
+    }
+    uint32_t retryMs = 0;
+    if(lane != WEB_LANE_CONTROL && _clientLimit.enabled()){
+        uint32_t key = _peers[(unsigned)httpd_req_to_sockfd(req) % CONFIG_LWIP_MAX_SOCKETS];
+        if(!_clients.bucket(key).take(_clientLimit, now, &retryMs)){
+            _clientLimited.fetch_add(1, std::memory_order_relaxed);
+            DLOGD(LOG_TAG, "%s: client over its limit, retry in %lu ms", req->uri, (unsigned long)retryMs);
+            _tooMany(req, retryMs);
+            return false;
+        }
+    }
+    if(target != nullptr && target->limit != nullptr && !target->bucket->take(*target->limit, now, &retryMs)){
+        _routeLimited.fetch_add(1, std::memory_order_relaxed);
+        DLOGD(LOG_TAG, "%s: route over its limit, retry in %lu ms", req->uri, (unsigned long)retryMs);
+        _tooMany(req, retryMs);
+        return false;
+    }
+    return true;
+}
+//Time the httpd task spent in handlers - async work on the pool does not count
+void serverManager::_busy(int64_t start, int64_t end){
+    if(_windowStart == 0){_windowStart = start;}
+    _busyUs += end - start;
+    int64_t window = end - _windowStart;
+    if(window >= WEB_BUSY_WINDOW_MS * 1000){
+        int64_t percent = _busyUs * 100 / window;
+        _busyPercent = (percent > 100) ? 100 : (uint8_t)percent;
+        _busyUs = 0;
+        _windowStart = end;
+    }
+}
+void serverManager::setClientLimit(float perSecond, uint16_t burst){
+    _configurable(server, "setClientLimit");
+    _clientLimit.set(perSecond, burst);
+}
+void serverManager::setRouteLimit(std::string pattern, float perSecond, uint16_t burst, webLane lane){
+    _configurable(server, "setRouteLimit");
+    limitData& limit = collLimit[pattern];
+    limit.perSecond = perSecond;
+    limit.burst = burst;
+    limit.lane = lane;
+}
+void serverManager::setLane(std::string pattern, webLane lane){
+    _configurable(server, "setLane");
+    collLimit[pattern].lane = lane;
+}
+void serverManager::setBulkShedding(uint8_t busyPercent, uint8_t freeSockets){
+    _configurable(server, "setBulkShedding");
+    _shedBusy = (busyPercent < 100) ? busyPercent : 99;
+    _shedFree = freeSockets;
+}
+serverManager::limitStats serverManager::getLimitStats() const {
+    return {_clientLimited.load(std::memory_order_relaxed), _routeLimited.load(std::memory_order_relaxed),
+            _shed.load(std::memory_order_relaxed), _clients.evictions(), (uint8_t)_clients.clients(),
+            _sessions.load(std::memory_order_relaxed), _busyPercent};
+}
@@ -3,9 +3,49 @@
 #include "esp_log.h"// Add ESP logging support
 //#include "esp_timer.h"// Include ESP timer support
 #include "esp_http_server.h" // Include ESP HTTP server
+#include "esp_idf_version.h"
+#include "jsonDispatch.h"// JSON field extractor and dispatch table
+#include "pushChannel.h"// WebSocket/SSE broadcast
+#include "routeTrie.h"// Path router with {param} and * segments
+#include "responseWriter.h"// Chunked writer and {{name}} templates
+#include "serverMetrics.h"// Per-route counters for enableMetrics()
+#include "rateLimiter.h"// Token buckets for setClientLimit()/setRouteLimit()
 //#include <stdint.h>
 //#include <string>
 //#include <map>
+#ifndef WEB_BODY_BLOCK
+#define WEB_BODY_BLOCK 512// Bytes per pooled receive block
+#endif
+#ifndef WEB_BODY_BLOCKS
+#define WEB_BODY_BLOCKS 4// Requests that can read a body at the same time
+#endif
+#ifndef WEB_BODY_RETRIES
+#define WEB_BODY_RETRIES 3// httpd_req_recv timeouts tolerated per request
+#endif
+#ifndef WEB_RX_MAX
+#define WEB_RX_MAX 64// Longest apiOption::rx that is matched across chunk boundaries
+#endif
+#ifndef WEB_ASSET_CHUNK
+#define WEB_ASSET_CHUNK 4096// Bytes per chunk when streaming an embedded asset from flash
+#endif
+#ifndef WEB_PATH_MAX
+#define WEB_PATH_MAX 128// Longest file path served by addStaticPath()
+#endif
+#ifndef WEB_ASYNC_MAX
+#define WEB_ASYNC_MAX 8// Request slots for setWorkers() - the most requests that can be in flight
+#endif
+#ifndef WEB_MAX_BODY
+#define WEB_MAX_BODY 8192// Default apiData::maxBody
+#endif
+#ifndef WEB_BUSY_WINDOW_MS
+#define WEB_BUSY_WINDOW_MS 200// httpd task load is measured over windows this long
+#endif
+//Admission priority of a route - see setLane()
+enum webLane : uint8_t{
+    WEB_LANE_CONTROL = 0,// Never shed, exempt from setClientLimit(); only its own route limit applies
+    WEB_LANE_NORMAL  = 1,// Default for pages, API and routes
+    WEB_LANE_BULK    = 2 // Default for assets and static files; shed first under load
+};
 // enum httpd_method_t{
 //     HTTP_GET     = 0,
 //     HTTP_POST    = 1,
@@ -22,6 +62,69 @@
 class serverManager{
     private:
         httpd_handle_t server = NULL;
+        httpd_config_t config;// Applied by begin(); the setters below change it
+        struct routeTarget{
+            httpd_method_t method;
+            esp_err_t (*handler)(httpd_req_t *req);// Built-in handlers, called with req->user_ctx = ctx
+            esp_err_t (*route)(httpd_req_t *req, const routeParams& params, void* parameter);// addRoute() handlers
+            void* ctx;
+            bool async;
+            serverMetrics::routeMetrics* metrics = nullptr;// Set by _addTarget() when metrics are on
+            webLane lane = WEB_LANE_NORMAL;
+            const rateLimit* limit = nullptr;// From collLimit; the bucket is shared by every method of the pattern
+            tokenBucket* bucket = nullptr;
+        };
+        struct routeSlot{
+            std::vector<routeTarget> targets;// One per method
+        };
+        routeTrie<routeSlot> routes;// Compiled by begin() from every collection except collPush
+        //Async requests: one slot per request in flight, owned by the worker until complete()
+        struct asyncSlot{
+            serverManager* self = nullptr;
+            httpd_req_t* req = nullptr;// Copy from httpd_req_async_handler_begin()
+            const void* option = nullptr;// const apiOption*
+            esp_err_t (*route)(httpd_req_t *req, const routeParams& params, void* parameter) = nullptr;
+            void* parameter = nullptr;
+            routeParams params;
+        };
+        asyncSlot _async[WEB_ASYNC_MAX];
+        std::atomic<uint32_t> _asyncUsed{0};// Bit i: _async[i] in flight, bit 31: stop() is draining
+        uint8_t _asyncLimit = 0;
+        Utils::taskManager* _workers = nullptr;
+        std::atomic<uint32_t> _asyncAccepted{0};
+        std::atomic<uint32_t> _asyncRejected{0};
+        std::atomic<uint32_t> _asyncCompleted{0};
+        std::atomic<uint8_t> _asyncPeak{0};
+        asyncSlot* _acquireAsync();
+        void _releaseAsync(asyncSlot* slot);
+        esp_err_t _startAsync(httpd_req_t *req, const void* option, esp_err_t (*route)(httpd_req_t*, const routeParams&, void*), void* parameter, const routeParams* params);
+        static void _asyncWork(void* arg);
+        friend esp_err_t _apihandler(httpd_req_t *req);
+        std::unique_ptr<serverMetrics> _metrics;// nullptr until enableMetrics()
+        std::string _metricsUri;
+        static esp_err_t _metricshandler(httpd_req_t *req);
+        static esp_err_t _sessionOpen(httpd_handle_t hd, int sockfd);
+        static void _sessionClose(httpd_handle_t hd, int sockfd);
+        static int _metricSend(httpd_handle_t hd, int sockfd, const char* buf, size_t len, int flags);
+        //Admission control - state below is only touched by the httpd task, so it needs no locks
+        rateLimit _clientLimit;
+        clientTable _clients;
+        uint32_t _peers[CONFIG_LWIP_MAX_SOCKETS] = {};// Client address key per socket, set when the session opens
+        uint8_t _shedBusy = 0;
+        uint8_t _shedFree = 0;
+        uint16_t _maxSessions = 0;
+        std::atomic<uint8_t> _sessions{0};
+        int64_t _windowStart = 0;
+        int64_t _busyUs = 0;
+        uint8_t _busyPercent = 0;
+        std::atomic<uint32_t> _clientLimited{0};
+        std::atomic<uint32_t> _routeLimited{0};
+        std::atomic<uint32_t> _shed{0};
+        bool _admit(httpd_req_t *req, const routeTarget* target, int64_t now);
+        void _busy(int64_t start, int64_t end);
+        static uint32_t _peerKey(int sockfd);
+        void _addTarget(const char* pattern, routeTarget target);
+        static esp_err_t _route(httpd_req_t *req);
         void _startRootFavicon();
     public:
         struct webData{
@@ -29,6 +132,7 @@ class serverManager{
             const char* html="";
             const char* status="";
             const char* error="";
+            size_t length=0;// Filled by addHTMLPath() so requests do not strlen the page
         };
         struct collWData{
             httpd_method_t method=HTTP_GET;
@@ -40,30 +144,155 @@ class serverManager{
             const char* type="application/json";// Response content type
             void (*handler)(void *pvPar)=nullptr;// Handler function
             void* parameter=nullptr;
+            bool async=false;// Run handler on the setWorkers() pool, then send tx - slow handlers do not block other clients
         };
+        //Called for every received chunk in order; data is only valid during the call.
+        //A final call with data=nullptr, len=0 marks the end of the body. Return false to reject the request
+        typedef bool (*bodyCallback)(const char* data, size_t len, size_t offset, void* parameter);
         struct apiData{
             httpd_method_t method=HTTP_POST;
             const char* error="Content too long";
             const char* uri="";
             std::map <std::string, apiOption> option;
+            size_t maxBody=WEB_MAX_BODY;// Larger bodies get 413
+            bodyCallback stream=nullptr;// Optional incremental parser fed with the raw body
+            void* streamParameter=nullptr;
+            //JSON mode: when set, the value of this top-level key selects the option whose rx equals it exactly
+            const char* field=nullptr;
+            dispatchTable<const apiOption*> dispatch;// Built by begin() from option when field is set
+        };
+        //File embedded in flash (EMBED_FILES) - streamed in place, never copied to RAM
+        struct staticAsset{
+            const char* uri="";
+            const uint8_t* data=nullptr;// _binary_<file>_start
+            size_t size=0;
+            const char* type="text/html";
+            bool gzip=false;// data is gzip-compressed: sent with Content-Encoding: gzip
+            const char* cacheControl="public, max-age=3600";
+            char etag[12]="";// Content hash, filled by addAsset()
+        };
+        //Directory on a mounted SPIFFS/LittleFS/FAT partition
+        struct staticDir{
+            std::string uri;// Prefix, registered as <uri>/*
+            std::string path;// VFS base path, e.g. "/spiffs"
+            const char* cacheControl="public, max-age=3600";
         };
         std::map <std::string, collWData> collWeb;
         std::map <std::string, apiData> collApi;
+        std::map <std::string, staticAsset> collAsset;
+        std::map <std::string, staticDir> collStatic;
+        //Path parameters of the matched pattern, e.g. params.copy("name", buf, sizeof(buf)) for /api/pin/{name}
+        typedef esp_err_t (*routeHandler)(httpd_req_t *req, const routeParams& params, void* parameter);
+        struct routeData{
+            httpd_method_t method=HTTP_GET;
+            std::string pattern;// "/api/pin/{name}", "/files/*"
+            routeHandler handler=nullptr;
+            void* parameter=nullptr;
+            bool async=false;// Run on the setWorkers() pool with a request copy; see complete()
+        };
+        std::map <std::string, routeData> collRoute;
+        //GET uri renders tpl with ctx - see sendTemplate()
+        struct templateData{
+            std::string uri;
+            const webTemplate* tpl=nullptr;// Must outlive the server
+            void* ctx=nullptr;
+            const char* type="text/html";
+        };
+        std::map <std::string, templateData> collTemplate;
+        //Lane and shared rate limit of a pattern, keyed by the pattern as registered: the uri of addHTMLPath()
+        //and addAsset(), "/" + uri for addAPIPath(), "<path>/*" for addStaticPath(), the pattern of addRoute()
+        struct limitData{
+            float perSecond=0;// 0: no route limit, lane only
+            uint16_t burst=1;
+            webLane lane=WEB_LANE_NORMAL;
+            rateLimit limit;// Built by begin()
+            tokenBucket bucket;
+        };
+        std::map <std::string, limitData> collLimit;
+        struct pushRoute{
+            const char* wsUri=nullptr;// WebSocket endpoint, nullptr for none
+            const char* sseUri=nullptr;// Server-Sent Events fallback, nullptr for none
+            pushChannel channel;
+        };
+        std::map <std::string, pushRoute> collPush;
         serverManager();
         httpd_handle_t begin();
         void addHTMLPath(std::string key,httpd_method_t method,webData data);
         void addAPIPath(std::string key, apiData apiData);
+        //Serves filePath/<rest> for GET path/<rest>; "name.gz" is preferred when the client accepts gzip
         void addStaticPath(std::string path, std::string filePath);
+        void addAsset(std::string key, staticAsset asset);
+        //For EMBED_FILES symbols: addAsset("app", "/app.js", app_js_gz_start, app_js_gz_end, "application/javascript", true)
+        void addAsset(std::string key, const char* uri, const uint8_t* start, const uint8_t* end, const char* type, bool gzip = false);
+        //Pattern segments: literal, {name} (one segment) or * (the rest, last only). Literals win over {name}, {name} over *
+        void addRoute(std::string key, httpd_method_t method, std::string pattern, routeHandler handler, void* parameter = nullptr, bool async = false);
+        void addTemplatePath(std::string key, std::string uri, const webTemplate* tpl, void* ctx = nullptr, const char* type = "text/html");
+        //Live updates: clients of wsUri and sseUri receive every publish(key, ...)
+        void addPushPath(std::string key, const char* wsUri, const char* sseUri = nullptr);
+        //Safe from any task - one serialization for all clients, newest message wins for slow ones
+        bool publish(std::string key, const char* payload, size_t len = 0);
+        pushChannel* channel(std::string key);
         static void sendResp(httpd_req_t *req,const char* resp,const char* type);
+        //Chunked responses through one pooled WEB_BODY_BLOCK scratch buffer - the page is never held in RAM.
+        //ESP_ERR_NO_MEM: pool exhausted (503 sent), ESP_FAIL: client went away
+        typedef void (*writeFn)(responseWriter& out, void* ctx);
+        static esp_err_t sendChunked(httpd_req_t *req, writeFn fill, void* ctx, const char* type = "text/html");
+        static esp_err_t sendTemplate(httpd_req_t *req, const webTemplate& tpl, void* ctx, const char* type = "text/html");
+        //Streams the request body through one pooled block - constant memory for any body size.
+        //ESP_ERR_INVALID_SIZE: over maxBody, ESP_ERR_NO_MEM: pool exhausted, ESP_ERR_TIMEOUT: client stalled,
+        //ESP_ERR_INVALID_STATE: callback rejected the body, ESP_FAIL: socket error
+        static esp_err_t readBody(httpd_req_t *req, size_t maxBody, bodyCallback callback, void* parameter);
+        //Async mode: routes with async=true run on the pool of tasks (startPool() first). Above maxInFlight requests,
+        //or when the pool is full, clients get 503. Keep maxInFlight below the socket limit so fast clients still connect
+        bool setWorkers(Utils::taskManager* tasks, uint8_t maxInFlight = 4);
+        //An async routeHandler that returns ESP_ERR_NOT_FINISHED keeps the request open; any task sends the
+        //response later and then calls complete(req). Every other return value completes it right away
+        static void complete(httpd_req_t *req);
+        struct asyncStats{
+            uint32_t accepted;
+            uint32_t rejected;// Answered 503: in-flight limit or pool full
+            uint32_t completed;
+            uint8_t inFlight;
+            uint8_t peak;
+        };
+        asyncStats getAsyncStats() const;
+        //Prometheus text at GET uri: per-route request counts by status class, body and response bytes, latency
+        //histograms, open sessions and async stats. Call before begin(); counters restart with every begin()
+        void enableMetrics(const char* uri = "/metrics");
+        //Admission control - call before begin(). Over-limit requests get 429 with Retry-After at once,
+        //before any handler runs or the body is read
+        void setClientLimit(float perSecond, uint16_t burst);// One bucket per client address, WEB_RATE_CLIENTS tracked; 0 disables
+        void setRouteLimit(std::string pattern, float perSecond, uint16_t burst, webLane lane = WEB_LANE_NORMAL);// One bucket shared by all clients
+        void setLane(std::string pattern, webLane lane);
+        //Bulk requests get 503 while the httpd task was busy more than busyPercent of the last window,
+        //or fewer than freeSockets sockets are free. 0 disables either test
+        void setBulkShedding(uint8_t busyPercent, uint8_t freeSockets = 0);
+        struct limitStats{
+            uint32_t clientLimited;// 429: client over setClientLimit()
+            uint32_t routeLimited;// 429: route over setRouteLimit()
+            uint32_t shed;// 503: bulk request under load
+            uint32_t evictions;// Clients pushed out of the table by new ones
+            uint8_t clients;
+            uint8_t sessions;
+            uint8_t busyPercent;// httpd task load in the last window
+        };
+        limitStats getLimitStats() const;
         // void removePath(std::string path);
         // void clearPaths();
-        // void setPort(uint16_t port);// Set server port - default 80
-        // void setMaxConnections(uint16_t maxConn);// Set maximum simultaneous connections - default 7
-        // void setTimeout(uint32_t timeout_ms);// Set timeout in milliseconds - default 5000
-        // void setStackSize(size_t stackSize);// Set stack size in bytes - default 4096
-        // void setTaskPriority(UBaseType_t priority);// Set task priority - use tskIDLE_PRIORITY + n
-        // void setCoreID(int coreID);// Set core ID for task affinity - use tskNO_AFFINITY for no affinity
+        //Tuning - call before begin(); a running server keeps its settings until stop() and begin()
+        void setPort(uint16_t port);// Set server port - default 80
+        void setMaxConnections(uint16_t maxConn);// Set maximum simultaneous connections - default 7, at most CONFIG_LWIP_MAX_SOCKETS - 3
+        void setBacklog(uint16_t backlog);// Connections waiting in accept() - default 5
+        void setTimeout(uint32_t timeout_ms);// Set receive/send timeout in milliseconds - default 5000, rounded up to seconds
+        void setStackSize(size_t stackSize);// Set stack size in bytes - default 4096
+        void setTaskPriority(UBaseType_t priority);// Set task priority - use tskIDLE_PRIORITY + n
+        void setCoreID(int coreID);// Set core ID for task affinity - use tskNO_AFFINITY for no affinity
+        void setLruPurge(bool enable);// Close the least recently used session when a new client finds all sockets busy - default on
+        void setKeepAlive(bool enable, int idle_s = 5, int interval_s = 5, int count = 3);// TCP keep-alive probes close dead clients - default off
         // void setTaskCapabilities(uint32_t capabilities);// Set task capabilities - bitwise OR of MALLOC_CAP_*
-        void stop();
+        httpd_config_t& getConfig();// Fields without a setter; same rules as the setters
+        bool isRunning() const;
+        //Waits for async requests in flight; ESP_ERR_TIMEOUT leaves the server running
+        esp_err_t stop(TickType_t timeout = portMAX_DELAY);
         ~serverManager();
 };
\ No newline at end of file
@@ -0,0 +1,88 @@
+#pragma once
+/**
+ * @brief Per-target GPIO capability tables used by pinManager to validate registrations.
+ *
+ * Tables are built at compile time for the target selected by sdkconfig
+ * (CONFIG_IDF_TARGET_*), so a lookup is a single array index.
+ */
+#include "sdkconfig.h"
+#include <array>
+#include <cstdint>
+
+namespace pinCaps{
+    enum : uint8_t {
+        EXISTS      = 1 << 0,// GPIO is bonded out on this target
+        INPUT_ONLY  = 1 << 1,// No output driver (and no internal pulls)
+        STRAPPING   = 1 << 2,// Sampled at reset - usable but affects boot mode
+        FLASH       = 1 << 3,// Wired to SPI flash/PSRAM - never usable
+        USB         = 1 << 4 // Native USB D-/D+
+    };
+    struct capInfo{
+        uint8_t flags = 0;
+        int8_t adcUnit = -1;// 0 = ADC1, 1 = ADC2, -1 = none
+        int8_t adcChannel = -1;
+    };
+#if defined(CONFIG_IDF_TARGET_ESP32S3)
+    constexpr const char* BOARD = "ESP32-S3";
+    constexpr int GPIO_COUNT = 49;
+#elif defined(CONFIG_IDF_TARGET_ESP32C3)
+    constexpr const char* BOARD = "ESP32-C3";
+    constexpr int GPIO_COUNT = 22;
+#elif defined(CONFIG_IDF_TARGET_ESP32)
+    constexpr const char* BOARD = "ESP32";
+    constexpr int GPIO_COUNT = 40;
+#else
+#error "pinCaps: unsupported target - add a GPIO table for it in pinCaps.h"
+#endif
+    using capTable = std::array<capInfo, GPIO_COUNT>;
+
+    constexpr void setRange(capTable& t, int first, int last, uint8_t flags){
+        for(int i = first; i <= last; i++){t[i].flags |= flags;}
+    }
+    constexpr void setAdc(capTable& t, int pin, int8_t unit, int8_t channel){
+        t[pin].adcUnit = unit;
+        t[pin].adcChannel = channel;
+    }
+    constexpr capTable makeTable(){
+        capTable t{};
+#if defined(CONFIG_IDF_TARGET_ESP32S3)
+        setRange(t, 0, 21, EXISTS);
+        setRange(t, 26, 48, EXISTS);
+        setRange(t, 26, 32, FLASH);
+        t[0].flags |= STRAPPING; t[3].flags |= STRAPPING;
+        t[45].flags |= STRAPPING; t[46].flags |= STRAPPING;
+        t[19].flags |= USB; t[20].flags |= USB;
+        for(int i = 1; i <= 10; i++){setAdc(t, i, 0, i - 1);}
+        for(int i = 11; i <= 20; i++){setAdc(t, i, 1, i - 11);}
+#elif defined(CONFIG_IDF_TARGET_ESP32C3)
+        setRange(t, 0, 21, EXISTS);
+        setRange(t, 12, 17, FLASH);
+        t[2].flags |= STRAPPING; t[8].flags |= STRAPPING; t[9].flags |= STRAPPING;
+        t[18].flags |= USB; t[19].flags |= USB;
+        for(int i = 0; i <= 4; i++){setAdc(t, i, 0, i);}
+        setAdc(t, 5, 1, 0);
+#elif defined(CONFIG_IDF_TARGET_ESP32)
+        setRange(t, 0, 19, EXISTS);
+        setRange(t, 21, 23, EXISTS);
+        setRange(t, 25, 27, EXISTS);
+        setRange(t, 32, 39, EXISTS);
+        setRange(t, 6, 11, FLASH);
+        setRange(t, 34, 39, INPUT_ONLY);
+        t[0].flags |= STRAPPING; t[2].flags |= STRAPPING; t[5].flags |= STRAPPING;
+        t[12].flags |= STRAPPING; t[15].flags |= STRAPPING;
+        setAdc(t, 36, 0, 0); setAdc(t, 37, 0, 1); setAdc(t, 38, 0, 2); setAdc(t, 39, 0, 3);
+        setAdc(t, 32, 0, 4); setAdc(t, 33, 0, 5); setAdc(t, 34, 0, 6); setAdc(t, 35, 0, 7);
+        setAdc(t, 4, 1, 0);  setAdc(t, 0, 1, 1);  setAdc(t, 2, 1, 2);  setAdc(t, 15, 1, 3);
+        setAdc(t, 13, 1, 4); setAdc(t, 12, 1, 5); setAdc(t, 14, 1, 6); setAdc(t, 27, 1, 7);
+        setAdc(t, 25, 1, 8); setAdc(t, 26, 1, 9);
+#endif
+        return t;
+    }
+    constexpr capTable TABLE = makeTable();
+
+    constexpr capInfo get(int pin){
+        return (pin >= 0 && pin < GPIO_COUNT) ? TABLE[pin] : capInfo{};
+    }
+    constexpr bool has(int pin, uint8_t flag){return (get(pin).flags & flag) != 0;}
+    constexpr bool usable(int pin){return has(pin, EXISTS) && !has(pin, FLASH);}
+}
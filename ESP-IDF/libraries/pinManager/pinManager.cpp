@@ -1,13 +1,45 @@
 #include "pinManager.h"
+#include "esp_attr.h"
+#include <cstring>
 
 #define PIN_TAG "PinManager"
 
-void pinManager::digitalPin(std::string name, int8_t pin, gpio_mode_t mode, gpio_pull_mode_t pull_mode){
-    // Validate pin number for ESP32 (GPIO 0-39, with some reserved pins)
-    if(pin < 0 || pin > 39) {
-        ESP_LOGE(PIN_TAG, "Invalid GPIO pin number: %d. ESP32 supports GPIO 0-39 only.", pin);
-        return;
+// Validate a GPIO against the target capability table and reserve it for one entry
+bool pinManager::claimPin(const std::string& name, const char* kind, int8_t pin, bool output){
+    if(!pinCaps::has(pin, pinCaps::EXISTS)) {
+        ESP_LOGE(PIN_TAG, "Invalid GPIO pin number: %d. Not available on %s.", pin, pinCaps::BOARD);
+        return false;
+    }
+    if(pinCaps::has(pin, pinCaps::FLASH)) {
+        ESP_LOGE(PIN_TAG, "GPIO %d is connected to SPI flash/PSRAM on %s.", pin, pinCaps::BOARD);
+        return false;
+    }
+    if(output && pinCaps::has(pin, pinCaps::INPUT_ONLY)) {
+        ESP_LOGE(PIN_TAG, "GPIO %d is input-only on %s and cannot be used as %s output.", pin, pinCaps::BOARD, kind);
+        return false;
+    }
+    auto it = pinOwner.find(pin);
+    if(it != pinOwner.end() && (it->second.name != name || strcmp(it->second.kind, kind) != 0)) {
+        ESP_LOGE(PIN_TAG, "GPIO %d already assigned to %s '%s'.", pin, it->second.kind, it->second.name.c_str());
+        return false;
     }
+    if(pinCaps::has(pin, pinCaps::STRAPPING)) {
+        ESP_LOGW(PIN_TAG, "GPIO %d is a strapping pin; external circuits may change the boot mode.", pin);
+    }
+    if(pinCaps::has(pin, pinCaps::USB)) {
+        ESP_LOGW(PIN_TAG, "GPIO %d is a native USB pin; USB console/JTAG will stop working.", pin);
+    }
+    // Re-registering an entry moves it, so release the GPIO it held before
+    for(auto owned = pinOwner.begin(); owned != pinOwner.end(); ){
+        if(owned->second.name == name && strcmp(owned->second.kind, kind) == 0 && owned->first != pin){owned = pinOwner.erase(owned);}
+        else{++owned;}
+    }
+    pinOwner[pin] = {name, kind};
+    return true;
+}
+void pinManager::digitalPin(std::string name, int8_t pin, gpio_mode_t mode, gpio_pull_mode_t pull_mode){
+    bool output = (mode & GPIO_MODE_DEF_OUTPUT) != 0;
+    if(!claimPin(name, "digital", pin, output)) {return;}
     
     pinMap[name]={static_cast<gpio_num_t>(pin), mode, PinType::DIGITAL, {0, 0, 0}};
     // Configure GPIO with specified pull mode
@@ -57,11 +89,7 @@ void pinManager::digitalWrite(std::string name, uint8_t value){
 }
 
 void pinManager::pwmPin(std::string name, int8_t pin, uint32_t frequency, ledc_timer_t timer, ledc_timer_bit_t duty_resolution){
-    // Validate pin number for ESP32 (GPIO 0-39, with some reserved pins)
-    if(pin < 0 || pin > 39) {
-        ESP_LOGE(PIN_TAG, "Invalid GPIO pin number: %d. ESP32 supports GPIO 0-39 only.", pin);
-        return;
-    }
+    if(!claimPin(name, "PWM", pin, true)) {return;}
     
     // Assign next available channel
     ledc_channel_t channel = static_cast<ledc_channel_t>(nextChannel);
@@ -172,12 +200,18 @@ void pinManager::update(){
         }
     }
 }
-// Register an ADC pin (GPIO 1-10, ADC1 channels 0-9)
+// Register an ADC pin - ADC1 channel is looked up in the target capability table
 void pinManager::analogPin(std::string name, int8_t pin){
-    if(pin < 1 || pin > 10){
-        ESP_LOGE(PIN_TAG, "Invalid ADC pin: %d. ESP32-S3 ADC1 supports GPIO 1-10 only.", pin);
+    pinCaps::capInfo cap = pinCaps::get(pin);
+    if(cap.adcUnit != 0){
+        if(cap.adcUnit == 1){
+            ESP_LOGE(PIN_TAG, "Invalid ADC pin: %d. It belongs to ADC2, which is shared with Wi-Fi; use an ADC1 pin.", pin);
+        }else{
+            ESP_LOGE(PIN_TAG, "Invalid ADC pin: %d. It has no ADC channel on %s.", pin, pinCaps::BOARD);
+        }
         return;
     }
+    if(!claimPin(name, "ADC", pin, false)) {return;}
     if(adcUnit == nullptr){
         adc_oneshot_unit_init_cfg_t unit_cfg = {
             .unit_id = ADC_UNIT_1,
@@ -186,7 +220,7 @@ void pinManager::analogPin(std::string name, int8_t pin){
         };
         adc_oneshot_new_unit(&unit_cfg, &adcUnit);
     }
-    adc_channel_t channel = static_cast<adc_channel_t>(pin - 1);
+    adc_channel_t channel = static_cast<adc_channel_t>(cap.adcChannel);
     adc_oneshot_chan_cfg_t chan_cfg = {
         .atten = ADC_ATTEN_DB_12,
         .bitwidth = ADC_BITWIDTH_DEFAULT
@@ -214,6 +248,133 @@ void pinManager::analogWrite(std::string name, uint8_t value){
     ledc_set_duty(LEDC_LOW_SPEED_MODE, pwmMap[name].channel, duty);
     ledc_update_duty(LEDC_LOW_SPEED_MODE, pwmMap[name].channel);
 }
+//--------------RMT Waveform Generator----------------
+// Clamp a duration to the 15-bit RMT field; zero would end the transmission early
+static inline IRAM_ATTR uint16_t waveTicks(uint16_t ticks){
+    if(ticks == 0) return 1;
+    return (ticks > 0x7FFF) ? 0x7FFF : ticks;
+}
+// Encoder callback - refills one half of the RMT memory from the user buffer (ISR context)
+size_t IRAM_ATTR pinManager::encodeBuffer(const void* data, size_t data_size, size_t symbols_written, size_t symbols_free, rmt_symbol_word_t* symbols, bool* done, void* arg){
+    const uint16_t* durations = static_cast<const uint16_t*>(data);
+    size_t count = data_size / sizeof(uint16_t);
+    size_t total = (count + 1) / 2; // Each symbol carries one active and one idle duration
+    uint8_t idle = static_cast<WaveInfo*>(arg)->idleLevel;
+    size_t n = 0;
+    for(size_t s = symbols_written; s < total && n < symbols_free; s++, n++){
+        size_t i = s * 2;
+        symbols[n].level0 = !idle;
+        symbols[n].duration0 = waveTicks(durations[i]);
+        symbols[n].level1 = idle;
+        symbols[n].duration1 = (i + 1 < count) ? waveTicks(durations[i + 1]) : 0; // Odd count: 0 marks the end
+    }
+    *done = (symbols_written + n) >= total;
+    return n;
+}
+// Encoder callback - emits identical pulses without any user buffer (ISR context)
+size_t IRAM_ATTR pinManager::encodeTrain(const void* data, size_t data_size, size_t symbols_written, size_t symbols_free, rmt_symbol_word_t* symbols, bool* done, void* arg){
+    const PulseTrain* train = static_cast<const PulseTrain*>(data);
+    uint8_t idle = static_cast<WaveInfo*>(arg)->idleLevel;
+    size_t n = 0;
+    for(size_t s = symbols_written; s < train->count && n < symbols_free; s++, n++){
+        symbols[n].level0 = !idle;
+        symbols[n].duration0 = train->high;
+        symbols[n].level1 = idle;
+        symbols[n].duration1 = train->low;
+    }
+    *done = (symbols_written + n) >= train->count;
+    return n;
+}
+// Register an RMT TX channel - the CPU only refills the pipeline once per half memory block
+bool pinManager::waveformPin(std::string name, int8_t pin, uint32_t resolution_hz, uint8_t idleLevel, size_t memSymbols){
+    if(waveMap.find(name) != waveMap.end()){
+        ESP_LOGE(PIN_TAG, "Waveform pin '%s' already registered.", name.c_str());
+        return false;
+    }
+    if(!claimPin(name, "waveform", pin, true)) {return false;}
+    WaveInfo& wave = waveMap[name];
+    wave.pin = static_cast<gpio_num_t>(pin);
+    wave.resolution = resolution_hz;
+    wave.idleLevel = idleLevel ? 1 : 0;
+
+    rmt_tx_channel_config_t tx_cfg = {};
+    tx_cfg.gpio_num = static_cast<gpio_num_t>(pin);
+    tx_cfg.clk_src = RMT_CLK_SRC_DEFAULT;
+    tx_cfg.resolution_hz = resolution_hz;
+    tx_cfg.mem_block_symbols = memSymbols;
+    tx_cfg.trans_queue_depth = WAVE_QUEUE_DEPTH;
+    tx_cfg.flags.invert_out = false;
+    esp_err_t err = rmt_new_tx_channel(&tx_cfg, &wave.channel);
+    if(err == ESP_OK){
+        // WaveInfo lives in a std::map node, so its address is stable for the encoder callbacks
+        rmt_simple_encoder_config_t enc_cfg = {};
+        enc_cfg.callback = encodeBuffer;
+        enc_cfg.arg = &wave;
+        enc_cfg.min_chunk_size = 1;
+        err = rmt_new_simple_encoder(&enc_cfg, &wave.bufEncoder);
+        if(err == ESP_OK){
+            enc_cfg.callback = encodeTrain;
+            err = rmt_new_simple_encoder(&enc_cfg, &wave.trainEncoder);
+        }
+        if(err == ESP_OK){err = rmt_enable(wave.channel);}
+    }
+    if(err != ESP_OK){
+        ESP_LOGE(PIN_TAG, "Failed to set up RMT for '%s': %s", name.c_str(), esp_err_to_name(err));
+        if(wave.trainEncoder != nullptr){rmt_del_encoder(wave.trainEncoder);}
+        if(wave.bufEncoder != nullptr){rmt_del_encoder(wave.bufEncoder);}
+        if(wave.channel != nullptr){rmt_del_channel(wave.channel);}
+        waveMap.erase(name);
+        pinOwner.erase(pin);
+        return false;
+    }
+    return true;
+}
+// Stream alternating active/idle durations (ticks). The buffer must stay valid until waveformDone()
+void pinManager::waveformWrite(std::string name, const uint16_t* durations, size_t count){
+    if(waveMap.find(name) == waveMap.end()){
+        ESP_LOGE(PIN_TAG, "Waveform pin '%s' not registered. Call waveformPin() first.", name.c_str());
+        return;
+    }
+    if(durations == nullptr || count == 0) return;
+    WaveInfo& wave = waveMap[name];
+    rmt_transmit_config_t tx_cfg = {};
+    tx_cfg.loop_count = 0;
+    tx_cfg.flags.eot_level = wave.idleLevel;
+    rmt_transmit(wave.channel, wave.bufEncoder, durations, count * sizeof(uint16_t), &tx_cfg);
+}
+// Generate count identical pulses - suited to stepper step signals
+void pinManager::waveformPulses(std::string name, uint16_t highTicks, uint16_t lowTicks, uint32_t count){
+    if(waveMap.find(name) == waveMap.end()){
+        ESP_LOGE(PIN_TAG, "Waveform pin '%s' not registered. Call waveformPin() first.", name.c_str());
+        return;
+    }
+    if(count == 0) return;
+    WaveInfo& wave = waveMap[name];
+    // rmt_transmit blocks while the queue is full, so the slot being written is never in flight
+    PulseTrain& train = wave.train[wave.nextTrain];
+    wave.nextTrain = (wave.nextTrain + 1) % (WAVE_QUEUE_DEPTH + 1);
+    train = {waveTicks(highTicks), waveTicks(lowTicks), count};
+    rmt_transmit_config_t tx_cfg = {};
+    tx_cfg.loop_count = 0;
+    tx_cfg.flags.eot_level = wave.idleLevel;
+    rmt_transmit(wave.channel, wave.trainEncoder, &train, sizeof(PulseTrain), &tx_cfg);
+}
+// Returns true when every queued waveform has been sent (timeout_ms=-1 waits forever)
+bool pinManager::waveformDone(std::string name, int32_t timeout_ms){
+    if(waveMap.find(name) == waveMap.end()){
+        ESP_LOGE(PIN_TAG, "Waveform pin '%s' not registered. Call waveformPin() first.", name.c_str());
+        return false;
+    }
+    return rmt_tx_wait_all_done(waveMap[name].channel, timeout_ms) == ESP_OK;
+}
+// Abort queued waveforms and return the pin to its idle level
+void pinManager::waveformStop(std::string name){
+    if(waveMap.find(name) != waveMap.end()){
+        WaveInfo& wave = waveMap[name];
+        rmt_disable(wave.channel);
+        rmt_enable(wave.channel);
+    }
+}
 /*
 pin.analogPin("sensor", 4);          // register GPIO4 as ADC input
 int raw = pin.analogRead("sensor");  // 0-4095
@@ -4,10 +4,15 @@
 #include "driver/gpio.h"
 #include "driver/ledc.h"
 #include "esp_adc/adc_oneshot.h"
+#include "driver/rmt_tx.h"
+#include "driver/rmt_encoder.h"
 #include "Counter.h"
+#include "pinCaps.h"
 #include <map>
 #include <string>
 
+#define WAVE_QUEUE_DEPTH 4 // Pending RMT transactions per waveform pin
+
 class pinManager{
     private:
         enum class PinType : uint8_t {
@@ -34,9 +39,33 @@ class pinManager{
             gpio_num_t pin;
             adc_channel_t channel;
         };
+        struct PulseTrain {
+            uint16_t high;// Ticks at active level
+            uint16_t low;// Ticks at idle level
+            uint32_t count;// Number of pulses
+        };
+        struct WaveInfo {
+            gpio_num_t pin;
+            rmt_channel_handle_t channel = nullptr;
+            rmt_encoder_handle_t bufEncoder = nullptr;// Streams user duration buffers
+            rmt_encoder_handle_t trainEncoder = nullptr;// Generates repeated pulses
+            uint32_t resolution = 1000000;
+            uint8_t idleLevel = 0;
+            PulseTrain train[WAVE_QUEUE_DEPTH + 1];// One slot per queued transaction (+1 being written)
+            uint8_t nextTrain = 0;
+        };
         std::map <std::string , PinInfo> pinMap;
         std::map <std::string , PwmInfo> pwmMap;
         std::map <std::string , AdcInfo> adcMap;
+        std::map <std::string , WaveInfo> waveMap;
+        struct PinOwner {
+            std::string name;
+            const char* kind;
+        };
+        std::map <uint8_t, PinOwner> pinOwner;// GPIO -> registered entry, rejects double assignment
+        bool claimPin(const std::string& name, const char* kind, int8_t pin, bool output);
+        static size_t encodeBuffer(const void* data, size_t data_size, size_t symbols_written, size_t symbols_free, rmt_symbol_word_t* symbols, bool* done, void* arg);
+        static size_t encodeTrain(const void* data, size_t data_size, size_t symbols_written, size_t symbols_free, rmt_symbol_word_t* symbols, bool* done, void* arg);
         adc_oneshot_unit_handle_t adcUnit = nullptr;
         uint8_t nextChannel = 0;
         
@@ -57,6 +86,12 @@ class pinManager{
         void analogPin(std::string name, int8_t pin);
         int  analogRead(std::string name);
         void analogWrite(std::string name, uint8_t value);
+        // RMT waveform generator - durations are in ticks of resolution_hz (1 MHz = microseconds)
+        bool waveformPin(std::string name, int8_t pin, uint32_t resolution_hz=1000000, uint8_t idleLevel=0, size_t memSymbols=64);
+        void waveformWrite(std::string name, const uint16_t* durations, size_t count);
+        void waveformPulses(std::string name, uint16_t highTicks, uint16_t lowTicks, uint32_t count);
+        bool waveformDone(std::string name, int32_t timeout_ms=0);
+        void waveformStop(std::string name);
         //gpio_num_t getPin(std::string name);
         //void configureInputPin(gpio_num_t pin, gpio_pull_mode_t pullMode);
 };
\ No newline at end of file
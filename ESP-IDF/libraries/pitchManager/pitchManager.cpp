@@ -141,6 +141,37 @@ void fNote::playMelody(std::string name, pinManager& pinMgr, std::string buzzerI
         }
     }
 }
+#ifdef __cpp_impl_coroutine
+cCo fNote::melody(std::string name, pinManager& pinMgr, std::string buzzerId,uint8_t volume,int16_t speed,bool reverse){
+    if(_melodies.find(name) == _melodies.end()){co_return;}
+    dtaMelody melody = _melodies[name];
+    int16_t tempo = (speed > 0) ? speed : melody.tempo;
+    int wholenote = (60000 * 4) / tempo;
+    _isPlaying = true;
+    for(size_t n = 0; n < melody.length; ++n){
+        size_t i = reverse ? melody.length - 1 - n : n;
+        int note = melody.melody[i];
+        int divider = melody.duration[i];
+        int64_t noteDuration = 0;
+        if (divider > 0) {
+            noteDuration = (wholenote) / divider;
+        } else if (divider < 0) {
+            // dotted notes are represented with negative durations!!
+            noteDuration = (wholenote) / abs(divider);
+            noteDuration *= 1.5; // increases the duration in half for dotted notes
+        }
+        if(note == REST){
+            pinMgr.noTone(buzzerId);
+        }else{
+            pinMgr.tone(buzzerId, note, volume);
+        }
+        co_await sleepMicros((noteDuration*0.9)*1000);
+        pinMgr.noTone(buzzerId);// Short pause between notes
+        co_await sleepMicros((noteDuration*0.1)*1000);
+    }
+    _isPlaying = false;
+}
+#endif
 fNote::~fNote(){
     _isPlaying = false;
     // Clean up dynamically allocated memory for melodies
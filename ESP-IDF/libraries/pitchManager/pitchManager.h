@@ -12,6 +12,9 @@
 #include <map>
 #include "counter.h"
 #include "pinManager.h"
+#ifdef __cpp_impl_coroutine
+#include "Coroutine.h"
+#endif
 
 // Note frequency definitions
 const std::map<std::string, uint16_t> mNote = {
@@ -176,6 +179,10 @@ class fNote{
     }
     void deleteMelody(std::string name);
     void playMelody(std::string name, pinManager& pinMgr, std::string buzzerId,uint8_t volume=50,int16_t speed=-1,bool reverse=false);
+#ifdef __cpp_impl_coroutine
+    // Non-blocking variant: spawn on a cCoLoop so several melodies/sequences share one task
+    cCo melody(std::string name, pinManager& pinMgr, std::string buzzerId,uint8_t volume=50,int16_t speed=-1,bool reverse=false);
+#endif
     dtaMelody getMelody(std::string name);
     bool isPlaying(){return _isPlaying;}
     //void addMelody(std::string name,int melody[], uint8_t duration[]);
@@ -1,4 +1,5 @@
 #include "wifiManager.h"
+#include "Logger.h"
 
 // Define global variables
 wifi_init_config_t wconfig;
@@ -120,19 +121,19 @@ void wifiConnection::wifiEventHandler(void* arg, esp_event_base_t event_base,
                 break;
             case WIFI_EVENT_STA_DISCONNECTED: {
                 wifi_event_sta_disconnected_t* disconnected = static_cast<wifi_event_sta_disconnected_t*>(event_data);
-                ESP_LOGW("wConnection", "Disconnected from WiFi. Reason: %d", disconnected->reason);
+                DLOGW("wConnection", "Disconnected from WiFi. Reason: %d", disconnected->reason);
                 if (instance->_retryCount < instance->_maxRetries) {
                     esp_wifi_connect();
                     instance->_retryCount++;
-                    ESP_LOGI("wConnection", "Retry %d/%d to connect to the AP", instance->_retryCount, instance->_maxRetries);
+                    DLOGI("wConnection", "Retry %d/%d to connect to the AP", instance->_retryCount, instance->_maxRetries);
                 } else {
-                    ESP_LOGE("wConnection", "Failed after %d retries", instance->_maxRetries);
+                    DLOGE("wConnection", "Failed after %d retries", instance->_maxRetries);
                     xEventGroupSetBits(instance->_wifiEventGroup, WIFI_FAIL_BIT);
                 }
                 break;
             }
             case WIFI_EVENT_AP_START:
-                ESP_LOGI("wConnection", "WiFi AP started");
+                DLOGI("wConnection", "WiFi AP started");
                 break;
             default:
                 break;
@@ -141,7 +142,7 @@ void wifiConnection::wifiEventHandler(void* arg, esp_event_base_t event_base,
         switch (event_id) {
             case IP_EVENT_STA_GOT_IP: {
                 ip_event_got_ip_t* event = static_cast<ip_event_got_ip_t*>(event_data);
-                ESP_LOGI("wConnection", "Got IP:" IPSTR, IP2STR(&event->ip_info.ip));
+                DLOGI("wConnection", "Got IP:" IPSTR, IP2STR(&event->ip_info.ip));
                 instance->_retryCount = 0;
                 
                 // Initialize mDNS to publish hostname
@@ -149,9 +150,9 @@ void wifiConnection::wifiEventHandler(void* arg, esp_event_base_t event_base,
                 if (err == ESP_OK) {
                     mdns_hostname_set(instance->_hostname.c_str());
                     mdns_instance_name_set(instance->_hostname.c_str());
-                    ESP_LOGI("wConnection", "mDNS hostname published: %s.local", instance->_hostname.c_str());
+                    DLOGI("wConnection", "mDNS hostname published: %s.local", instance->_hostname.c_str());
                 } else {
-                    ESP_LOGW("wConnection", "Failed to initialize mDNS: %s", esp_err_to_name(err));
+                    DLOGW("wConnection", "Failed to initialize mDNS: %s", esp_err_to_name(err));
                 }
                 
                 xEventGroupSetBits(instance->_wifiEventGroup, WIFI_CONNECTED_BIT);